@@ -0,0 +1,113 @@
+#include "ai.h"
+
+#include <algorithm>
+
+static const DifficultyLevel LEVELS[] = {
+    {6, 3},  // easy
+    {3, 1},  // normal
+    {1, 0},  // hard
+    {0, 0}   // perfect
+};
+
+static const char* const NAMES[] = {"easy", "normal", "hard", "perfect"};
+
+// Сложность приходит из настроек, повторов и сети: значение вне перечисления — ближайший уровень.
+static int clampDifficulty(Difficulty difficulty) {
+    return std::max(static_cast<int>(DIFFICULTY_EASY), std::min(static_cast<int>(difficulty), static_cast<int>(DIFFICULTY_PERFECT)));
+}
+
+const DifficultyLevel& difficultyLevel(Difficulty difficulty) {
+    return LEVELS[clampDifficulty(difficulty)];
+}
+
+const char* difficultyName(Difficulty difficulty) {
+    return NAMES[clampDifficulty(difficulty)];
+}
+
+bool parseDifficulty(const std::string& name, Difficulty& difficulty) {
+    for (int i = 0; i < 4; i++) {
+        if (name == NAMES[i]) {
+            difficulty = static_cast<Difficulty>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+int predictRow(const Ball& ball, int ticks, int field_height) {
+    long long unfolded = ball.getFixedY() + static_cast<long long>(ball.getDY()) * ticks;
+    return foldBallY(unfolded, field_height) >> BALL_SHIFT;
+}
+
+bool predictIntercept(const Ball& ball, int column, int field_height, int& row, int& ticks) {
+    long long distance = static_cast<long long>(column) * BALL_ONE - ball.getFixedX();
+    if (distance == 0 || ball.getDX() == 0 || (distance > 0) != (ball.getDX() > 0)) return false;
+    long long speed = ball.getDX() > 0 ? ball.getDX() : -ball.getDX();
+    if (distance < 0) distance = -distance;
+    ticks = static_cast<int>((distance + speed - 1) / speed);
+    // Строка в момент пересечения колонки, а не в конце тика: на большой скорости это разные строки.
+    long long unfolded = ball.getFixedY() + static_cast<long long>(ball.getDY()) * distance / speed;
+    row = foldBallY(unfolded, field_height) >> BALL_SHIFT;
+    return true;
+}
+
+ComputerAI::ComputerAI(Difficulty difficulty, uint64_t seed)
+    : level(difficultyLevel(difficulty)), rng(seed), hasTarget(false),
+      cachedDX(0), cachedDY(0), cachedPoints(0), cachedWidth(0), cachedHeight(0), target(0), aimOffset(0), reactionLeft(0) {}
+
+int ComputerAI::move(const GameState& state, const Paddle& paddle) {
+    const Ball& ball = state.ball;
+
+    // Пересчёт только при смене направления (удар о ракетку, стену) или новой подаче:
+    // после очка или смены поля мяч может лететь туда же, но из другой точки.
+    int points = state.player1Score + state.player2Score;
+    bool served = points != cachedPoints || state.field_width != cachedWidth || state.field_height != cachedHeight;
+    if (!hasTarget || served || ball.getDX() != cachedDX || ball.getDY() != cachedDY) {
+        bool newDX = !hasTarget || served || ball.getDX() != cachedDX;
+        if (newDX) {
+            // Ошибка прицела выбирается один раз на подход мяча, а не на каждый отскок.
+            aimOffset = level.aimError > 0 ? rng.range(2 * level.aimError + 1) - level.aimError : 0;
+            reactionLeft = level.reactionTicks;
+        }
+        int row, ticks;
+        if (predictIntercept(ball, paddle.getX(), state.field_height, row, ticks)) {
+            target = row + aimOffset;
+        } else {
+            target = state.field_height / 2;  // Мяч улетает: возвращаемся в центр.
+        }
+        hasTarget = true;
+        cachedDX = ball.getDX();
+        cachedDY = ball.getDY();
+        cachedPoints = points;
+        cachedWidth = state.field_width;
+        cachedHeight = state.field_height;
+    }
+
+    if (reactionLeft > 0) {
+        reactionLeft--;
+        return 0;
+    }
+
+    int center = paddle.getY() + paddle.getHeight() / 2;
+    if (target < center) return -1;
+    if (target > center) return 1;
+    return 0;
+}
+
+ComputerAIState ComputerAI::save() const {
+    return ComputerAIState{rng.state, hasTarget, cachedDX, cachedDY, cachedPoints, cachedWidth, cachedHeight,
+                           target, aimOffset, reactionLeft};
+}
+
+void ComputerAI::restore(const ComputerAIState& saved) {
+    rng.state = saved.rng;
+    hasTarget = saved.hasTarget;
+    cachedDX = saved.cachedDX;
+    cachedDY = saved.cachedDY;
+    cachedPoints = saved.cachedPoints;
+    cachedWidth = saved.cachedWidth;
+    cachedHeight = saved.cachedHeight;
+    target = saved.target;
+    aimOffset = saved.aimOffset;
+    reactionLeft = saved.reactionLeft;
+}
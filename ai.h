@@ -0,0 +1,76 @@
+#ifndef PONG_AI_H
+#define PONG_AI_H
+
+// Компьютерный противник с предсказанием траектории.
+// Вместо погони за мячом каждый тик ИИ один раз решает, где мяч пересечёт колонку ракетки
+// (отражения от стен разворачиваются в замкнутой форме), и держит эту цель,
+// пока мяч не сменит направление или не будет подан заново (очко, перезагрузка настроек с другим полем).
+
+#include "game.h"
+
+#include <string>
+
+enum Difficulty {
+    DIFFICULTY_EASY = 0,
+    DIFFICULTY_NORMAL = 1,
+    DIFFICULTY_HARD = 2,
+    DIFFICULTY_PERFECT = 3
+};
+
+// Параметры уровня сложности.
+struct DifficultyLevel {
+    int reactionTicks;  // Сколько тиков ИИ стоит на месте после смены направления мяча.
+    int aimError;       // Максимальная ошибка прицела в строках (случайная, на каждое новое предсказание).
+};
+
+const DifficultyLevel& difficultyLevel(Difficulty difficulty);
+const char* difficultyName(Difficulty difficulty);
+bool parseDifficulty(const std::string& name, Difficulty& difficulty);
+
+// Строка, на которой мяч окажется через ticks тиков: движение по вертикали — «пила»
+// между стенами 1 и field_height - 2, поэтому отражения сворачиваются взятием остатка (foldBallY).
+int predictRow(const Ball& ball, int ticks, int field_height);
+
+// Где и через сколько тиков мяч дойдёт до колонки column.
+// false, если мяч летит от колонки.
+bool predictIntercept(const Ball& ball, int column, int field_height, int& row, int& ticks);
+
+// Внутреннее состояние ComputerAI для ключевых кадров повторов.
+struct ComputerAIState {
+    uint64_t rng;
+    bool hasTarget;
+    int cachedDX;
+    int cachedDY;
+    int cachedPoints;
+    int cachedWidth;
+    int cachedHeight;
+    int target;
+    int aimOffset;
+    int reactionLeft;
+};
+
+class ComputerAI {
+private:
+    DifficultyLevel level;
+    Rng rng;
+    bool hasTarget;     // Есть ли закэшированная цель.
+    int cachedDX;       // Направление мяча, для которого посчитана цель.
+    int cachedDY;
+    int cachedPoints;   // Сумма очков: после очка мяч подан заново, возможно, в том же направлении.
+    int cachedWidth;    // Поле, для которого посчитана цель: resizeGame переносит ракетку и мяч.
+    int cachedHeight;
+    int target;         // Строка, на которую нужно поставить центр ракетки.
+    int aimOffset;      // Ошибка прицела на текущий подход мяча.
+    int reactionLeft;   // Тиков до начала реакции на новое направление.
+
+public:
+    explicit ComputerAI(Difficulty difficulty = DIFFICULTY_NORMAL, uint64_t seed = 0);
+
+    // Ход за ракетку paddle: -1 вверх, 0 стоять, 1 вниз.
+    int move(const GameState& state, const Paddle& paddle);
+
+    ComputerAIState save() const;
+    void restore(const ComputerAIState& saved);
+};
+
+#endif
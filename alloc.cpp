@@ -0,0 +1,52 @@
+#include "alloc.h"
+
+#include <cstdlib>
+#include <new>
+
+// Замена глобальных operator new/delete: то же, что у стандартной библиотеки (malloc/free),
+// плюс счётчик. Счётчик свой у каждого потока, поэтому не нужны атомарные операции.
+static thread_local uint64_t allocations = 0;
+
+uint64_t allocationCount() {
+    return allocations;
+}
+
+void* operator new(std::size_t size) {
+    allocations++;
+    if (size == 0) size = 1;
+    for (;;) {
+        if (void* p = malloc(size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    allocations++;
+    size_t alignment = static_cast<size_t>(align);
+    size = (size + alignment - 1) / alignment * alignment;
+    if (size == 0) size = alignment;
+    for (;;) {
+        if (void* p = aligned_alloc(alignment, size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    free(p);
+}
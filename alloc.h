@@ -0,0 +1,11 @@
+#ifndef PONG_ALLOC_H
+#define PONG_ALLOC_H
+
+// Счётчик вызовов глобального operator new в текущем потоке. Нужен проверке --check-alloc:
+// установившийся игровой цикл не должен выделять память.
+
+#include <cstdint>
+
+uint64_t allocationCount();
+
+#endif
@@ -0,0 +1,76 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+MatchArena::MatchArena(size_t initialSize) : current(0), offset(0), used(0) {
+    Block block{static_cast<char*>(::operator new(initialSize)), initialSize};
+    blocks.reserve(32);
+    blocks.push_back(block);
+}
+
+MatchArena::~MatchArena() {
+    for (const Block& block : blocks) ::operator delete(block.data);
+}
+
+void* MatchArena::allocate(size_t size, size_t align) {
+    for (;;) {
+        Block& block = blocks[current];
+        size_t start = (offset + align - 1) & ~(align - 1);
+        if (start + size <= block.size) {
+            used += start + size - offset;
+            offset = start + size;
+            return block.data + start;
+        }
+        // Текущий блок кончился: следующий из уже выделенных или новый, вдвое больше и не меньше запроса.
+        used += block.size - offset;
+        if (current + 1 == blocks.size()) {
+            size_t next = block.size * 2;
+            while (next < size + align) next *= 2;
+            Block fresh{static_cast<char*>(::operator new(next)), next};
+            blocks.push_back(fresh);
+        }
+        current++;
+        offset = 0;
+    }
+}
+
+void MatchArena::reset() {
+    current = 0;
+    offset = 0;
+    used = 0;
+}
+
+size_t MatchArena::getCapacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks) total += block.size;
+    return total;
+}
+
+void ArenaBytes::grow() {
+    Chunk* chunk = static_cast<Chunk*>(arena->allocate(sizeof(Chunk) + CHUNK_SIZE, alignof(Chunk)));
+    chunk->next = nullptr;
+    chunk->used = 0;
+    if (last) last->next = chunk;
+    else first = chunk;
+    last = chunk;
+}
+
+void ArenaBytes::append(const char* bytes, size_t size) {
+    while (size > 0) {
+        if (!last || last->used == CHUNK_SIZE) grow();
+        size_t part = std::min(size, CHUNK_SIZE - last->used);
+        memcpy(last->data() + last->used, bytes, part);
+        last->used += part;
+        total += part;
+        bytes += part;
+        size -= part;
+    }
+}
+
+void ArenaBytes::assign(const char* bytes, size_t size) {
+    first = last = nullptr;
+    total = 0;
+    append(bytes, size);
+}
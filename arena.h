@@ -0,0 +1,79 @@
+#ifndef PONG_ARENA_H
+#define PONG_ARENA_H
+
+// Память на одну партию: всё, что копится по тикам (запись повтора, служебные буферы),
+// берётся из арены сдвигом указателя и освобождается разом в reset() перед следующей партией.
+// Блоки арены после reset() остаются за ней, поэтому со второй партии игровой цикл
+// не обращается к operator new вовсе.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class MatchArena {
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+    std::vector<Block> blocks;
+    size_t current;  // Блок, из которого сейчас выдаётся память.
+    size_t offset;   // Занято в текущем блоке.
+    size_t used;     // Выдано с последнего reset(), включая потери на выравнивание.
+
+    MatchArena(const MatchArena&) = delete;
+    MatchArena& operator=(const MatchArena&) = delete;
+
+public:
+    // Первый блок выделяется сразу; когда он кончается, следующий вдвое больше.
+    explicit MatchArena(size_t initialSize = 1 << 20);
+    ~MatchArena();
+
+    void* allocate(size_t size, size_t align);
+    void reset();  // Забыть всё выданное; блоки остаются для следующей партии.
+
+    size_t getUsed() const { return used; }
+    size_t getCapacity() const;
+};
+
+// Байтовый буфер в арене, кусками по CHUNK_SIZE байт. Дописывание не переносит уже записанное:
+// растущая строка в арене при каждом удвоении оставляла бы в ней старую копию (арена не
+// освобождает по одному), и длинная партия выбирала бы блок и шла за новым в operator new.
+// Пишется теми же putVarint()/putSigned(), что и std::string.
+class ArenaBytes {
+private:
+    struct Chunk {
+        Chunk* next;
+        size_t used;
+        char* data() { return reinterpret_cast<char*>(this + 1); }
+        const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+    };
+    static const size_t CHUNK_SIZE = 16384;
+
+    MatchArena* arena;
+    Chunk* first;
+    Chunk* last;
+    size_t total;
+
+    void grow();
+
+public:
+    explicit ArenaBytes(MatchArena& arena) : arena(&arena), first(nullptr), last(nullptr), total(0) {}
+
+    void push_back(char byte) {
+        if (!last || last->used == CHUNK_SIZE) grow();
+        last->data()[last->used++] = byte;
+        total++;
+    }
+    void append(const char* bytes, size_t size);
+    void assign(const char* bytes, size_t size);  // Куски прежнего содержимого остаются в арене до reset().
+    size_t size() const { return total; }
+
+    // Содержимое по порядку: fn(data, size) на каждый кусок.
+    template <class Fn>
+    void forEachChunk(Fn fn) const {
+        for (const Chunk* chunk = first; chunk; chunk = chunk->next) fn(chunk->data(), chunk->used);
+    }
+};
+
+#endif
@@ -0,0 +1,342 @@
+#include "batch.h"
+
+#include <chrono>
+#include <cstdio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PONG_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+static const int BATCH_LANES = 8;  // Ширина AVX2 в int32: массивы дополняются до кратного.
+
+BatchGames newBatch(const Config& config, int count, uint64_t seed) {
+    BatchGames batch;
+    batch.count = count;
+    batch.padded = (count + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES;
+    batch.field_width = config.field_width;
+    batch.field_height = config.field_height;
+    batch.max_score = config.max_score;
+
+    int n = batch.padded;
+    batch.x.assign(n, config.field_width / 2);
+    batch.y.assign(n, config.field_height / 2);
+    batch.dx.assign(n, 1);
+    batch.dy.assign(n, 1);
+    batch.p1y.assign(n, config.field_height / 2 - config.paddle_height / 2);
+    batch.p1h.assign(n, config.paddle_height);
+    batch.p2y.assign(n, config.field_height / 2 - config.paddle_height / 2);
+    batch.p2h.assign(n, config.paddle_height);
+    batch.score1.assign(n, 0);
+    batch.score2.assign(n, 0);
+    batch.ticks.assign(n, 0);
+
+    Rng rng(seed);
+    for (int i = 0; i < count; i++) {
+        // Мяч стартует в центральной колонке на случайной строке внутри стен.
+        if (config.field_height > 4) batch.y[i] = 2 + rng.range(config.field_height - 4);
+        batch.dx[i] = rng.range(2) ? 1 : -1;
+        batch.dy[i] = rng.range(2) ? 1 : -1;
+    }
+    for (int i = count; i < n; i++) batch.score1[i] = config.max_score;  // Хвост: уже завершённые партии.
+    return batch;
+}
+
+GameState batchGame(const BatchGames& batch, const Config& config, int i) {
+    GameState state = newGame(config, MODE_COMPUTER);
+    state.ball.setX(batch.x[i]);
+    state.ball.setY(batch.y[i]);
+    state.ball.setDX(batch.dx[i] * BALL_ONE);
+    state.ball.setDY(batch.dy[i] * BALL_ONE);
+    state.player1.setY(batch.p1y[i]);
+    state.player1.setHeight(batch.p1h[i]);
+    state.player2.setY(batch.p2y[i]);
+    state.player2.setHeight(batch.p2h[i]);
+    state.player1Score = batch.score1[i];
+    state.player2Score = batch.score2[i];
+    state.tick = batch.ticks[i];
+    state.finished = batch.score1[i] >= batch.max_score || batch.score2[i] >= batch.max_score;
+    return state;
+}
+
+// Скалярный путь. Те же маски, что и в векторных: m = 0 или -1, смена знака v = (v ^ m) - m.
+static void stepScalar(BatchGames& b) {
+    const int W = b.field_width, H = b.field_height, maxScore = b.max_score;
+    for (int i = 0; i < b.padded; i++) {
+        int32_t x = b.x[i], y = b.y[i], dx = b.dx[i], dy = b.dy[i];
+        int32_t p1 = b.p1y[i], h1 = b.p1h[i], p2 = b.p2y[i], h2 = b.p2h[i];
+        int32_t s1 = b.score1[i], s2 = b.score2[i];
+
+        int32_t active = -static_cast<int32_t>(s1 < maxScore && s2 < maxScore);
+
+        // Ход компьютеров по мячу до перемещения (как computerMove перед step()).
+        int32_t up1 = -static_cast<int32_t>(y < p1), down1 = -static_cast<int32_t>(y > p1 + h1);
+        int32_t up2 = -static_cast<int32_t>(y < p2), down2 = -static_cast<int32_t>(y > p2 + h2);
+
+        // Мяч и отражение от верхней и нижней стен.
+        x += dx;
+        y += dy;
+        int32_t wall = -static_cast<int32_t>(y <= 1 || y >= H - 2);
+        dy = (dy ^ wall) - wall;
+
+        // Ракетки в пределах поля.
+        p1 += (up1 & -static_cast<int32_t>(p1 > 1)) - (down1 & -static_cast<int32_t>(p1 + h1 < H - 1));
+        p2 += (up2 & -static_cast<int32_t>(p2 > 1)) - (down2 & -static_cast<int32_t>(p2 + h2 < H - 1));
+
+        // Попадание в ракетку.
+        int32_t hit = -static_cast<int32_t>((x == 1 && y >= p1 && y < p1 + h1) || (x == W - 2 && y >= p2 && y < p2 + h2));
+        dx = (dx ^ hit) - hit;
+
+        // Гол и подача из центра.
+        int32_t outLeft = -static_cast<int32_t>(x <= 0), outRight = -static_cast<int32_t>(x >= W - 1);
+        int32_t out = outLeft | outRight;
+        s2 -= outLeft;
+        s1 -= outRight;
+        x = (out & (W / 2)) | (~out & x);
+        y = (out & (H / 2)) | (~out & y);
+        dx = (dx ^ out) - out;
+
+        // Завершённые партии не меняются.
+        b.x[i] = (active & x) | (~active & b.x[i]);
+        b.y[i] = (active & y) | (~active & b.y[i]);
+        b.dx[i] = (active & dx) | (~active & b.dx[i]);
+        b.dy[i] = (active & dy) | (~active & b.dy[i]);
+        b.p1y[i] = (active & p1) | (~active & b.p1y[i]);
+        b.p2y[i] = (active & p2) | (~active & b.p2y[i]);
+        b.score1[i] = (active & s1) | (~active & b.score1[i]);
+        b.score2[i] = (active & s2) | (~active & b.score2[i]);
+        b.ticks[i] -= active;
+    }
+}
+
+#ifdef PONG_BATCH_X86
+
+// SSE2: 4 партии за итерацию. Сравнения a <= b записываются как b + 1 > a.
+static void stepSse2(BatchGames& b) {
+    const int W = b.field_width, H = b.field_height;
+    const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+    const __m128i lastRow = _mm_set1_epi32(H - 3);    // y >= H - 2  <=>  y > H - 3
+    const __m128i bottom = _mm_set1_epi32(H - 1);
+    const __m128i rightX = _mm_set1_epi32(W - 2);
+    const __m128i centerX = _mm_set1_epi32(W / 2), centerY = _mm_set1_epi32(H / 2);
+    const __m128i scoreLimit = _mm_set1_epi32(b.max_score - 1);
+
+    for (int i = 0; i < b.padded; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b.x[i]));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b.y[i]));
+        __m128i dx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b.dx[i]));
+        __m128i dy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b.dy[i]));
+        __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b.p1y[i]));
+        __m128i h1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b.p1h[i]));
+        __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b.p2y[i]));
+        __m128i h2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b.p2h[i]));
+        __m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b.score1[i]));
+        __m128i s2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b.score2[i]));
+        __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b.ticks[i]));
+
+        __m128i done = _mm_or_si128(_mm_cmpgt_epi32(s1, scoreLimit), _mm_cmpgt_epi32(s2, scoreLimit));
+
+        __m128i p1end = _mm_add_epi32(p1, h1), p2end = _mm_add_epi32(p2, h2);
+        __m128i up1 = _mm_cmpgt_epi32(p1, y), down1 = _mm_cmpgt_epi32(y, p1end);
+        __m128i up2 = _mm_cmpgt_epi32(p2, y), down2 = _mm_cmpgt_epi32(y, p2end);
+
+        __m128i nx = _mm_add_epi32(x, dx);
+        __m128i ny = _mm_add_epi32(y, dy);
+        __m128i wall = _mm_or_si128(_mm_cmpgt_epi32(two, ny), _mm_cmpgt_epi32(ny, lastRow));
+        __m128i ndy = _mm_sub_epi32(_mm_xor_si128(dy, wall), wall);
+
+        __m128i np1 = _mm_add_epi32(p1, _mm_sub_epi32(_mm_and_si128(up1, _mm_cmpgt_epi32(p1, one)),
+                                                      _mm_and_si128(down1, _mm_cmpgt_epi32(bottom, p1end))));
+        __m128i np2 = _mm_add_epi32(p2, _mm_sub_epi32(_mm_and_si128(up2, _mm_cmpgt_epi32(p2, one)),
+                                                      _mm_and_si128(down2, _mm_cmpgt_epi32(bottom, p2end))));
+
+        __m128i in1 = _mm_andnot_si128(_mm_cmpgt_epi32(np1, ny), _mm_cmpgt_epi32(_mm_add_epi32(np1, h1), ny));
+        __m128i in2 = _mm_andnot_si128(_mm_cmpgt_epi32(np2, ny), _mm_cmpgt_epi32(_mm_add_epi32(np2, h2), ny));
+        __m128i hit = _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi32(nx, one), in1),
+                                   _mm_and_si128(_mm_cmpeq_epi32(nx, rightX), in2));
+        __m128i ndx = _mm_sub_epi32(_mm_xor_si128(dx, hit), hit);
+
+        __m128i outLeft = _mm_cmpgt_epi32(one, nx), outRight = _mm_cmpgt_epi32(nx, rightX);
+        __m128i out = _mm_or_si128(outLeft, outRight);
+        __m128i ns2 = _mm_sub_epi32(s2, outLeft);
+        __m128i ns1 = _mm_sub_epi32(s1, outRight);
+        nx = _mm_or_si128(_mm_and_si128(out, centerX), _mm_andnot_si128(out, nx));
+        ny = _mm_or_si128(_mm_and_si128(out, centerY), _mm_andnot_si128(out, ny));
+        ndx = _mm_sub_epi32(_mm_xor_si128(ndx, out), out);
+
+        // done ? старое : новое
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&b.x[i]), _mm_or_si128(_mm_and_si128(done, x), _mm_andnot_si128(done, nx)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&b.y[i]), _mm_or_si128(_mm_and_si128(done, y), _mm_andnot_si128(done, ny)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&b.dx[i]), _mm_or_si128(_mm_and_si128(done, dx), _mm_andnot_si128(done, ndx)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&b.dy[i]), _mm_or_si128(_mm_and_si128(done, dy), _mm_andnot_si128(done, ndy)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&b.p1y[i]), _mm_or_si128(_mm_and_si128(done, p1), _mm_andnot_si128(done, np1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&b.p2y[i]), _mm_or_si128(_mm_and_si128(done, p2), _mm_andnot_si128(done, np2)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&b.score1[i]), _mm_or_si128(_mm_and_si128(done, s1), _mm_andnot_si128(done, ns1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&b.score2[i]), _mm_or_si128(_mm_and_si128(done, s2), _mm_andnot_si128(done, ns2)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&b.ticks[i]), _mm_add_epi32(t, _mm_andnot_si128(done, one)));
+    }
+}
+
+// AVX2: 8 партий за итерацию, та же последовательность операций, что и в SSE2.
+__attribute__((target("avx2")))
+static void stepAvx2(BatchGames& b) {
+    const int W = b.field_width, H = b.field_height;
+    const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+    const __m256i lastRow = _mm256_set1_epi32(H - 3);
+    const __m256i bottom = _mm256_set1_epi32(H - 1);
+    const __m256i rightX = _mm256_set1_epi32(W - 2);
+    const __m256i centerX = _mm256_set1_epi32(W / 2), centerY = _mm256_set1_epi32(H / 2);
+    const __m256i scoreLimit = _mm256_set1_epi32(b.max_score - 1);
+
+    for (int i = 0; i < b.padded; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b.x[i]));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b.y[i]));
+        __m256i dx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b.dx[i]));
+        __m256i dy = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b.dy[i]));
+        __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b.p1y[i]));
+        __m256i h1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b.p1h[i]));
+        __m256i p2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b.p2y[i]));
+        __m256i h2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b.p2h[i]));
+        __m256i s1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b.score1[i]));
+        __m256i s2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b.score2[i]));
+        __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b.ticks[i]));
+
+        __m256i done = _mm256_or_si256(_mm256_cmpgt_epi32(s1, scoreLimit), _mm256_cmpgt_epi32(s2, scoreLimit));
+
+        __m256i p1end = _mm256_add_epi32(p1, h1), p2end = _mm256_add_epi32(p2, h2);
+        __m256i up1 = _mm256_cmpgt_epi32(p1, y), down1 = _mm256_cmpgt_epi32(y, p1end);
+        __m256i up2 = _mm256_cmpgt_epi32(p2, y), down2 = _mm256_cmpgt_epi32(y, p2end);
+
+        __m256i nx = _mm256_add_epi32(x, dx);
+        __m256i ny = _mm256_add_epi32(y, dy);
+        __m256i wall = _mm256_or_si256(_mm256_cmpgt_epi32(two, ny), _mm256_cmpgt_epi32(ny, lastRow));
+        __m256i ndy = _mm256_sub_epi32(_mm256_xor_si256(dy, wall), wall);
+
+        __m256i np1 = _mm256_add_epi32(p1, _mm256_sub_epi32(_mm256_and_si256(up1, _mm256_cmpgt_epi32(p1, one)),
+                                                            _mm256_and_si256(down1, _mm256_cmpgt_epi32(bottom, p1end))));
+        __m256i np2 = _mm256_add_epi32(p2, _mm256_sub_epi32(_mm256_and_si256(up2, _mm256_cmpgt_epi32(p2, one)),
+                                                            _mm256_and_si256(down2, _mm256_cmpgt_epi32(bottom, p2end))));
+
+        __m256i in1 = _mm256_andnot_si256(_mm256_cmpgt_epi32(np1, ny), _mm256_cmpgt_epi32(_mm256_add_epi32(np1, h1), ny));
+        __m256i in2 = _mm256_andnot_si256(_mm256_cmpgt_epi32(np2, ny), _mm256_cmpgt_epi32(_mm256_add_epi32(np2, h2), ny));
+        __m256i hit = _mm256_or_si256(_mm256_and_si256(_mm256_cmpeq_epi32(nx, one), in1),
+                                      _mm256_and_si256(_mm256_cmpeq_epi32(nx, rightX), in2));
+        __m256i ndx = _mm256_sub_epi32(_mm256_xor_si256(dx, hit), hit);
+
+        __m256i outLeft = _mm256_cmpgt_epi32(one, nx), outRight = _mm256_cmpgt_epi32(nx, rightX);
+        __m256i out = _mm256_or_si256(outLeft, outRight);
+        __m256i ns2 = _mm256_sub_epi32(s2, outLeft);
+        __m256i ns1 = _mm256_sub_epi32(s1, outRight);
+        nx = _mm256_blendv_epi8(nx, centerX, out);
+        ny = _mm256_blendv_epi8(ny, centerY, out);
+        ndx = _mm256_sub_epi32(_mm256_xor_si256(ndx, out), out);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&b.x[i]), _mm256_blendv_epi8(nx, x, done));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&b.y[i]), _mm256_blendv_epi8(ny, y, done));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&b.dx[i]), _mm256_blendv_epi8(ndx, dx, done));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&b.dy[i]), _mm256_blendv_epi8(ndy, dy, done));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&b.p1y[i]), _mm256_blendv_epi8(np1, p1, done));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&b.p2y[i]), _mm256_blendv_epi8(np2, p2, done));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&b.score1[i]), _mm256_blendv_epi8(ns1, s1, done));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&b.score2[i]), _mm256_blendv_epi8(ns2, s2, done));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&b.ticks[i]), _mm256_add_epi32(t, _mm256_andnot_si256(done, one)));
+    }
+}
+
+#endif
+
+bool kernelSupported(BatchKernel kernel) {
+#ifdef PONG_BATCH_X86
+    if (kernel == KERNEL_AVX2) return __builtin_cpu_supports("avx2");
+    if (kernel == KERNEL_SSE2) return __builtin_cpu_supports("sse2");
+#endif
+    return kernel == KERNEL_SCALAR;
+}
+
+BatchKernel bestKernel() {
+    if (kernelSupported(KERNEL_AVX2)) return KERNEL_AVX2;
+    if (kernelSupported(KERNEL_SSE2)) return KERNEL_SSE2;
+    return KERNEL_SCALAR;
+}
+
+const char* kernelName(BatchKernel kernel) {
+    switch (kernel) {
+        case KERNEL_AVX2: return "avx2";
+        case KERNEL_SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+void stepBatch(BatchGames& batch, BatchKernel kernel) {
+#ifdef PONG_BATCH_X86
+    if (kernel == KERNEL_AVX2) { stepAvx2(batch); return; }
+    if (kernel == KERNEL_SSE2) { stepSse2(batch); return; }
+#endif
+    stepScalar(batch);
+}
+
+// Сравнение партии пакета с эталонным GameState.
+static bool sameGame(const BatchGames& b, int i, const GameState& s) {
+    return b.x[i] * BALL_ONE == s.ball.getFixedX() && b.y[i] * BALL_ONE == s.ball.getFixedY()
+        && b.dx[i] * BALL_ONE == s.ball.getDX() && b.dy[i] * BALL_ONE == s.ball.getDY()
+        && b.p1y[i] == s.player1.getY() && b.p2y[i] == s.player2.getY()
+        && b.score1[i] == s.player1Score && b.score2[i] == s.player2Score
+        && b.ticks[i] == s.tick;
+}
+
+int runBatchBenchmark(const Config& settings, int games, int ticks) {
+    using Clock = std::chrono::steady_clock;
+    const uint64_t seed = 1;
+
+    // Ядра пакета знают только классический мяч, поэтому и эталон играет без разгона и подкрутки.
+    Config config = settings;
+    config.ball_speed = 1.0f;
+    config.ball_max_speed = 1.0f;
+    config.ball_speedup = 0;
+    config.ball_spin = 0;
+
+    // Эталон: те же партии объектами Ball/Paddle через step().
+    BatchGames initial = newBatch(config, games, seed);
+    std::vector<GameState> states;
+    for (int i = 0; i < games; i++) states.push_back(batchGame(initial, config, i));
+
+    Clock::time_point start = Clock::now();
+    Inputs inputs;
+    for (int t = 0; t < ticks; t++) {
+        for (GameState& state : states) {
+            if (state.finished) continue;
+            inputs.player1 = computerMove(state, state.player1);
+            inputs.player2 = computerMove(state, state.player2);
+            step(state, inputs);
+        }
+    }
+    double objectSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double gameTicks = static_cast<double>(games) * ticks;
+
+    printf("games: %d, ticks: %d\n", games, ticks);
+    printf("%-8s %10s %14s %9s  %s\n", "path", "time(s)", "game-ticks/s", "speedup", "state");
+    printf("%-8s %10.3f %14.0f %8.2fx  %s\n", "objects", objectSeconds,
+           objectSeconds > 0 ? gameTicks / objectSeconds : 0.0, 1.0, "reference");
+
+    int status = 0;
+    for (BatchKernel kernel : {KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2}) {
+        if (!kernelSupported(kernel)) {
+            printf("%-8s %10s\n", kernelName(kernel), "unsupported");
+            continue;
+        }
+        BatchGames batch = initial;
+        start = Clock::now();
+        for (int t = 0; t < ticks; t++) stepBatch(batch, kernel);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        int mismatches = 0;
+        for (int i = 0; i < games; i++) {
+            if (!sameGame(batch, i, states[i])) mismatches++;
+        }
+        if (mismatches) status = 1;
+        printf("%-8s %10.3f %14.0f %8.2fx  %s\n", kernelName(kernel), seconds,
+               seconds > 0 ? gameTicks / seconds : 0.0, seconds > 0 ? objectSeconds / seconds : 0.0,
+               mismatches ? "MISMATCH" : "identical");
+    }
+    return status;
+}
@@ -0,0 +1,53 @@
+#ifndef PONG_BATCH_H
+#define PONG_BATCH_H
+
+// Пакетная физика: K независимых партий Computer vs Computer в виде структуры массивов (SoA).
+// Все партии продвигаются за один проход без ветвлений: отражение от стен и попадание
+// в ракетку считаются масками. Есть пути AVX2, SSE2 и скалярный; результаты у них
+// побитово совпадают между собой и с step() для тех же партий.
+// Пакет моделирует классическую физику: целые клетки, скорость мяча ровно клетка за тик.
+
+#include "game.h"
+
+#include <vector>
+
+enum BatchKernel {
+    KERNEL_SCALAR = 0,
+    KERNEL_SSE2 = 1,
+    KERNEL_AVX2 = 2
+};
+
+struct BatchGames {
+    int count;          // Число партий.
+    int padded;         // Размер массивов, кратный ширине самого широкого вектора.
+    int field_width;
+    int field_height;
+    int max_score;
+
+    // По элементу на партию. Хвост после count заполнен завершёнными партиями.
+    std::vector<int32_t> x, y, dx, dy;   // Мяч, в клетках.
+    std::vector<int32_t> p1y, p1h;       // Левая ракетка (x = 1).
+    std::vector<int32_t> p2y, p2h;       // Правая ракетка (x = field_width - 2).
+    std::vector<int32_t> score1, score2;
+    std::vector<int32_t> ticks;          // Сыграно тиков; завершённые партии не продвигаются.
+};
+
+// K партий по настройкам; seed разводит начальные позиции и направления мяча.
+BatchGames newBatch(const Config& config, int count, uint64_t seed);
+
+// Партия i пакета в виде обычного GameState (для сверки с step()).
+GameState batchGame(const BatchGames& batch, const Config& config, int i);
+
+// Один тик всех партий выбранным путём.
+void stepBatch(BatchGames& batch, BatchKernel kernel);
+
+// Лучший путь, доступный на этом процессоре.
+BatchKernel bestKernel();
+bool kernelSupported(BatchKernel kernel);
+const char* kernelName(BatchKernel kernel);
+
+// Микробенчмарк: объекты Ball/Paddle через step() против всех доступных путей пакета,
+// со сверкой состояния. Возвращает код завершения процесса.
+int runBatchBenchmark(const Config& config, int games, int ticks);
+
+#endif
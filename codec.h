@@ -0,0 +1,81 @@
+#ifndef PONG_CODEC_H
+#define PONG_CODEC_H
+
+// Компактное кодирование чисел для повторов и сетевых кадров:
+// varint (7 бит на байт, старший бит — продолжение) и zigzag для чисел со знаком.
+// Писать можно в любой байтовый буфер с push_back(): std::string или ArenaBytes из arena.h.
+
+#include <cstdint>
+#include <string>
+
+template <class Out>
+inline void putVarint(Out& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+template <class Out>
+inline void putSigned(Out& out, int64_t value) {
+    putVarint(out, zigzag(value));
+}
+
+// Последовательное чтение из буфера. При выходе за конец ok становится false, а чтения возвращают 0.
+struct Reader {
+    const unsigned char* pos;
+    const unsigned char* end;
+    bool ok;
+
+    Reader(const void* data, size_t size)
+        : pos(static_cast<const unsigned char*>(data)), end(static_cast<const unsigned char*>(data) + size), ok(true) {}
+
+    bool atEnd() const { return pos >= end; }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= end) {
+                ok = false;
+                return 0;
+            }
+            unsigned char byte = *pos++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    int64_t signedVarint() { return unzigzag(varint()); }
+
+    unsigned char byte() {
+        if (pos >= end) {
+            ok = false;
+            return 0;
+        }
+        return *pos++;
+    }
+
+    std::string bytes(size_t count) {
+        if (static_cast<size_t>(end - pos) < count) {
+            ok = false;
+            pos = end;
+            return std::string();
+        }
+        std::string value(reinterpret_cast<const char*>(pos), count);
+        pos += count;
+        return value;
+    }
+};
+
+#endif
@@ -0,0 +1,566 @@
+#include "config.h"
+#include "ai.h"
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+enum FieldType {
+    FIELD_FLOAT,
+    FIELD_INT,
+    FIELD_TEXT,        // min/max — допустимая длина.
+    FIELD_DIFFICULTY   // Имя уровня сложности: easy, normal, hard, perfect.
+};
+
+// Ключ config.ini и поле Config, в которое он попадает.
+struct ConfigField {
+    const char* key;
+    FieldType type;
+    float Config::* real;
+    int Config::* integer;
+    std::string Config::* text;
+    double min, max;
+};
+
+static const ConfigField SCHEMA[] = {
+    {"speed", FIELD_FLOAT, &Config::speed, nullptr, nullptr, 0.01, 100},
+    {"max_score", FIELD_INT, nullptr, &Config::max_score, nullptr, 1, 1000000},
+    {"field_width", FIELD_INT, nullptr, &Config::field_width, nullptr, 12, 1000},
+    {"field_height", FIELD_INT, nullptr, &Config::field_height, nullptr, 6, 1000},
+    {"paddle_height", FIELD_INT, nullptr, &Config::paddle_height, nullptr, 1, 997},
+    {"name_Player1", FIELD_TEXT, nullptr, nullptr, &Config::name_Player1, 0, 32},
+    {"name_Player2", FIELD_TEXT, nullptr, nullptr, &Config::name_Player2, 0, 32},
+    {"frame_rate", FIELD_INT, nullptr, &Config::frame_rate, nullptr, 1, 1000},
+    {"ai_difficulty", FIELD_DIFFICULTY, nullptr, &Config::ai_difficulty, nullptr, 0, 0},
+    {"replay_dir", FIELD_TEXT, nullptr, nullptr, &Config::replay_dir, 0, 255},
+    {"ball_speed", FIELD_FLOAT, &Config::ball_speed, nullptr, nullptr, 1.0 / BALL_ONE, 64},
+    {"ball_max_speed", FIELD_FLOAT, &Config::ball_max_speed, nullptr, nullptr, 1.0 / BALL_ONE, 64},
+    {"ball_speedup", FIELD_INT, nullptr, &Config::ball_speedup, nullptr, 0, 100},
+    {"ball_spin", FIELD_INT, nullptr, &Config::ball_spin, nullptr, 0, 100},
+};
+
+static const ConfigField* findField(const std::string& key) {
+    for (const ConfigField& field : SCHEMA) {
+        if (key[0] == field.key[0] && key == field.key) return &field;
+    }
+    return nullptr;
+}
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static void trim(const char*& begin, const char*& end) {
+    while (begin < end && isBlank(*begin)) begin++;
+    while (end > begin && isBlank(end[-1])) end--;
+}
+
+static std::string lineError(int line, const std::string& message) {
+    return "config line " + std::to_string(line) + ": " + message;
+}
+
+const ConfigSection* ConfigFile::find(const std::string& name) const {
+    for (const ConfigSection& section : sections) {
+        if (section.name == name) return &section;
+    }
+    return nullptr;
+}
+
+void parseConfigText(const char* text, size_t size, ConfigFile& file) {
+    // Разделы и строки прошлого разбора переиспользуются: повторное чтение того же файла
+    // (перезагрузка, бенчмарк) почти не выделяет память.
+    if (file.sections.empty()) file.sections.resize(1);
+    for (ConfigSection& section : file.sections) section.entries.clear();
+    file.sections[0].name.clear();
+    file.errors.clear();
+    size_t used = 1;
+    size_t current = 0;
+
+    const char* pos = text;
+    const char* end = text + size;
+    for (int line = 1; pos < end; line++) {
+        const char* eol = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        if (!eol) eol = end;
+        const char* begin = pos;
+        const char* stop = eol;
+        pos = eol < end ? eol + 1 : end;
+        trim(begin, stop);
+        if (begin == stop || *begin == ';' || *begin == '#') continue;
+
+        if (*begin == '[') {
+            const char* nameBegin = begin + 1;
+            const char* nameEnd = stop - 1;
+            if (stop - begin < 2 || *nameEnd != ']') {
+                file.errors.push_back(lineError(line, "section header without ']'"));
+                continue;
+            }
+            trim(nameBegin, nameEnd);
+            size_t length = nameEnd - nameBegin;
+            if (length == 0) {
+                file.errors.push_back(lineError(line, "empty section name"));
+                continue;
+            }
+            // Повторный заголовок продолжает тот же раздел.
+            for (current = 1; current < used; current++) {
+                const std::string& name = file.sections[current].name;
+                if (name.size() == length && memcmp(name.data(), nameBegin, length) == 0) break;
+            }
+            if (current == used) {
+                if (used == file.sections.size()) file.sections.emplace_back();
+                file.sections[used++].name.assign(nameBegin, length);
+            }
+            continue;
+        }
+
+        const char* equals = static_cast<const char*>(memchr(begin, '=', stop - begin));
+        if (!equals) {
+            file.errors.push_back(lineError(line, "expected 'key = value'"));
+            continue;
+        }
+        const char* keyBegin = begin;
+        const char* keyEnd = equals;
+        const char* valueBegin = equals + 1;
+        const char* valueEnd = stop;
+        trim(keyBegin, keyEnd);
+        trim(valueBegin, valueEnd);
+        if (keyBegin == keyEnd) {
+            file.errors.push_back(lineError(line, "missing key before '='"));
+            continue;
+        }
+        // Кавычки сохраняют пробелы по краям значения.
+        if (valueEnd - valueBegin >= 2 && *valueBegin == '"' && valueEnd[-1] == '"') {
+            valueBegin++;
+            valueEnd--;
+        }
+        std::vector<ConfigEntry>& entries = file.sections[current].entries;
+        entries.emplace_back();
+        entries.back().key.assign(keyBegin, keyEnd);
+        entries.back().value.assign(valueBegin, valueEnd);
+        entries.back().line = line;
+    }
+    file.sections.resize(used);
+}
+
+bool readConfigFile(const std::string& path, ConfigFile& file) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        parseConfigText("", 0, file);
+        return false;
+    }
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    parseConfigText(content.data(), content.size(), file);
+    return true;
+}
+
+// Значение одного ключа. false (и поле без изменений), если значение не подходит.
+static bool setField(Config& config, const ConfigField& field, const std::string& value, std::string& error) {
+    if (field.type == FIELD_TEXT) {
+        if (value.size() < field.min || value.size() > field.max) {
+            error = "'" + std::string(field.key) + "' is longer than " + std::to_string(static_cast<int>(field.max));
+            return false;
+        }
+        config.*field.text = value;
+        return true;
+    }
+    if (field.type == FIELD_DIFFICULTY) {
+        Difficulty difficulty;
+        if (!parseDifficulty(value, difficulty)) {
+            error = "'" + std::string(field.key) + "' must be easy, normal, hard or perfect";
+            return false;
+        }
+        config.*field.integer = difficulty;
+        return true;
+    }
+
+    // Числа: значение целиком, конечное и в диапазоне схемы.
+    char buffer[64];
+    char* parsedEnd = nullptr;
+    double number = NAN;
+    if (!value.empty() && value.size() < sizeof(buffer)) {
+        memcpy(buffer, value.data(), value.size());
+        buffer[value.size()] = '\0';
+        if (field.type == FIELD_INT) {
+            long integer = strtol(buffer, &parsedEnd, 10);
+            number = static_cast<double>(integer);
+        } else {
+            number = strtod(buffer, &parsedEnd);
+        }
+    }
+    if (!parsedEnd || *parsedEnd != '\0' || parsedEnd == buffer || !std::isfinite(number) ||
+        number < field.min || number > field.max) {
+        char range[64];
+        snprintf(range, sizeof(range), "%g..%g", field.min, field.max);
+        error = "'" + std::string(field.key) + "' must be a number in " + range + ", got '" + value + "'";
+        return false;
+    }
+    if (field.type == FIELD_INT) config.*field.integer = static_cast<int>(number);
+    else config.*field.real = static_cast<float>(number);
+    return true;
+}
+
+static void applySection(const ConfigSection& section, Config& config, std::vector<std::string>& errors) {
+    std::string error;
+    for (const ConfigEntry& entry : section.entries) {
+        const ConfigField* field = findField(entry.key);
+        if (!field) {
+            errors.push_back(lineError(entry.line, "unknown key '" + entry.key + "'"));
+        } else if (!setField(config, *field, entry.value, error)) {
+            errors.push_back(lineError(entry.line, error));
+        }
+    }
+}
+
+void validateConfig(Config& config, std::vector<std::string>& errors) {
+    // Ракетка ходит между строками 1 и field_height - 2 и должна там помещаться.
+    int maxPaddle = config.field_height - 3;
+    if (config.paddle_height > maxPaddle) {
+        errors.push_back("paddle_height " + std::to_string(config.paddle_height) + " does not fit field_height " +
+                         std::to_string(config.field_height) + ", using " + std::to_string(maxPaddle));
+        config.paddle_height = maxPaddle;
+    }
+    if (config.ball_max_speed < config.ball_speed) {
+        errors.push_back("ball_max_speed is below ball_speed, using ball_speed");
+        config.ball_max_speed = config.ball_speed;
+    }
+}
+
+bool configInRange(const Config& config, std::string& error) {
+    for (const ConfigField& field : SCHEMA) {
+        bool ok = true;
+        if (field.type == FIELD_FLOAT) {
+            float value = config.*field.real;
+            ok = value >= field.min && value <= field.max;  // NaN не проходит ни одно сравнение.
+        } else if (field.type == FIELD_INT) {
+            int value = config.*field.integer;
+            ok = value >= field.min && value <= field.max;
+        } else if (field.type == FIELD_DIFFICULTY) {
+            int value = config.*field.integer;
+            ok = value >= DIFFICULTY_EASY && value <= DIFFICULTY_PERFECT;
+        } else if (field.type == FIELD_TEXT) {
+            size_t length = (config.*field.text).size();
+            ok = length >= field.min && length <= field.max;
+        }
+        if (!ok) {
+            error = std::string("'") + field.key + "' is out of range";
+            return false;
+        }
+    }
+    if (config.paddle_height > config.field_height - 3) {
+        error = "paddle_height does not fit field_height";
+        return false;
+    }
+    if (config.ball_max_speed < config.ball_speed) {
+        error = "ball_max_speed is below ball_speed";
+        return false;
+    }
+    return true;
+}
+
+bool resolveConfig(const ConfigFile& file, const std::string& profile, Config& config,
+                   std::vector<std::string>& errors) {
+    config = Config();
+    applySection(file.sections[0], config, errors);
+    bool found = true;
+    if (!profile.empty()) {
+        const ConfigSection* section = file.find(profile);
+        if (section) applySection(*section, config, errors);
+        else errors.push_back("no profile [" + profile + "] in the config");
+        found = section != nullptr;
+    }
+    validateConfig(config, errors);
+    return found;
+}
+
+Config loadConfig(const std::string& path, const std::string& profile, std::vector<std::string>* errors) {
+    ConfigFile file;
+    std::vector<std::string> problems;
+    readConfigFile(path, file);
+    problems = file.errors;
+    Config config;
+    resolveConfig(file, profile, config, problems);
+    if (errors) *errors = problems;
+    return config;
+}
+
+// Значение поля в виде, который читается обратно без потерь.
+static std::string fieldValue(const Config& config, const ConfigField& field) {
+    char buffer[64];
+    switch (field.type) {
+        case FIELD_FLOAT: {
+            // Самая короткая запись, из которой читается то же число: 0.1, а не 0.100000001.
+            float value = config.*field.real;
+            for (int precision = 6; precision <= 9; precision++) {
+                snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+                if (strtof(buffer, nullptr) == value) break;
+            }
+            return buffer;
+        }
+        case FIELD_INT:
+            return std::to_string(config.*field.integer);
+        case FIELD_DIFFICULTY:
+            return difficultyName(static_cast<Difficulty>(config.*field.integer));
+        case FIELD_TEXT:
+            return config.*field.text;
+    }
+    return std::string();
+}
+
+// Строка "key = value". Пустое значение и пробелы или кавычки по краям сохраняются только в кавычках.
+static void putEntry(std::string& text, const std::string& key, const std::string& value) {
+    bool quote = value.empty() || isBlank(value.front()) || isBlank(value.back()) ||
+                 value.front() == '"' || value.back() == '"';
+    text += key;
+    text += quote ? " = \"" : " = ";
+    text += value;
+    text += quote ? "\"\n" : "\n";
+}
+
+std::string configText(const Config& config) {
+    std::string text;
+    for (const ConfigField& field : SCHEMA) putEntry(text, field.key, fieldValue(config, field));
+    return text;
+}
+
+bool saveConfig(const std::string& path, const Config& config, const std::string& profile) {
+    ConfigFile file;
+    readConfigFile(path, file);
+
+    std::vector<ConfigEntry> entries;
+    if (profile.empty()) {
+        for (const ConfigField& field : SCHEMA) entries.push_back(ConfigEntry{field.key, fieldValue(config, field), 0});
+        file.sections[0].entries = entries;
+    } else {
+        // В профиль — только отличия от общего раздела.
+        Config base;
+        std::vector<std::string> ignored;
+        resolveConfig(file, "", base, ignored);
+        for (const ConfigField& field : SCHEMA) {
+            std::string value = fieldValue(config, field);
+            if (value != fieldValue(base, field)) entries.push_back(ConfigEntry{field.key, value, 0});
+        }
+        ConfigSection* section = nullptr;
+        for (ConfigSection& candidate : file.sections) {
+            if (candidate.name == profile) section = &candidate;
+        }
+        if (!section) {
+            file.sections.push_back(ConfigSection{profile, {}});
+            section = &file.sections.back();
+        }
+        section->entries = entries;
+    }
+
+    std::string text;
+    for (const ConfigSection& section : file.sections) {
+        if (!section.name.empty()) text += (text.empty() ? "[" : "\n[") + section.name + "]\n";
+        for (const ConfigEntry& entry : section.entries) putEntry(text, entry.key, entry.value);
+    }
+    // Запись через временный файл: наблюдатель и другая копия игры не увидят файл наполовину.
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        out << text;
+        if (!out) return false;
+    }
+    return rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool liveSettingsDiffer(const Config& a, const Config& b) {
+    return a.speed != b.speed || a.paddle_height != b.paddle_height ||
+           a.field_width != b.field_width || a.field_height != b.field_height;
+}
+
+ConfigWatcher::ConfigWatcher() : fd(-1) {}
+
+ConfigWatcher::~ConfigWatcher() {
+    if (fd >= 0) close(fd);
+}
+
+bool ConfigWatcher::watch(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    name = slash == std::string::npos ? path : path.substr(slash + 1);
+    if (fd < 0) fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return false;
+    return inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) >= 0;
+}
+
+bool ConfigWatcher::changed() {
+    if (fd < 0) return false;
+    bool touched = false;
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t size = read(fd, buffer, sizeof(buffer));
+        if (size <= 0) break;
+        for (char* pos = buffer; pos < buffer + size;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(pos);
+            if (event->len > 0 && name == event->name) touched = true;
+            pos += sizeof(inotify_event) + event->len;
+        }
+    }
+    return touched;
+}
+
+int runConfigBenchmark(const std::string& path, long long iterations) {
+    using Clock = std::chrono::steady_clock;
+    std::string text;
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (in.is_open()) text.assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        else text = configText(Config());
+    }
+    // Большой файл: общий раздел и тысяча профилей по три ключа.
+    std::string large = configText(Config());
+    for (int i = 0; i < 1000; i++) {
+        large += "\n[profile-" + std::to_string(i) + "]\nspeed = " + std::to_string(1 + i % 7) +
+                 "\nfield_width = " + std::to_string(40 + i % 500) + "\nname_Player1 = \"  player " +
+                 std::to_string(i) + "  \"\n";
+    }
+
+    ConfigFile file;
+    Config config;
+    std::vector<std::string> errors;
+    long long sink = 0;
+
+    Clock::time_point start = Clock::now();
+    for (long long i = 0; i < iterations; i++) {
+        parseConfigText(text.data(), text.size(), file);
+        errors.clear();
+        resolveConfig(file, "", config, errors);
+        sink += config.field_width;
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    long long largeIterations = iterations / 100 > 0 ? iterations / 100 : 1;
+    start = Clock::now();
+    for (long long i = 0; i < largeIterations; i++) {
+        parseConfigText(large.data(), large.size(), file);
+        errors.clear();
+        resolveConfig(file, "profile-999", config, errors);
+        sink += config.field_width;
+    }
+    double largeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf("file:           %s (%zu bytes)\n", path.c_str(), text.size());
+    printf("loads:          %lld\n", iterations);
+    printf("loads/sec:      %.0f\n", seconds > 0 ? iterations / seconds : 0.0);
+    printf("ns/load:        %.0f\n", iterations > 0 ? seconds * 1e9 / iterations : 0.0);
+    printf("large file:     %zu bytes, 1000 profiles\n", large.size());
+    printf("large loads:    %lld\n", largeIterations);
+    printf("MB/sec:         %.1f\n", largeSeconds > 0 ? large.size() * largeIterations / largeSeconds / 1e6 : 0.0);
+    printf("checksum:       %lld\n", sink);
+    return 0;
+}
+
+// Строки, которые фаззер вставляет в файл: граничные, нечисловые и синтаксически сломанные.
+static const char* const FUZZ_LINES[] = {
+    "speed = nan", "speed = inf", "speed = -1", "speed = 1e40", "speed = 0x10", "speed =",
+    "field_width = 99999999999999999999", "field_width = 12", "field_height = 6", "field_height = 3",
+    "paddle_height = 997", "paddle_height = 0", "max_score = 1.5", "max_score = 1000000",
+    "ball_speed = 64", "ball_max_speed = 0.001", "ball_spin = 101", "ball_speedup = -5",
+    "ai_difficulty = perfect", "ai_difficulty = impossible", "name_Player1 = \"  spaced  \"",
+    "name_Player2 = \"\"", "name_Player1 = \"\"\"", "replay_dir = \"\"", "unknown = 1", "= 5",
+    "[", "[]", "[lan", "[lan]", "[huge-field]", "; comment = 1", "# [lan]", "speed 5",
+};
+
+static const char FUZZ_BYTES[] = "\n=[]\"; #\0 9x.-e";
+
+static bool fieldsEqual(const Config& a, const Config& b) {
+    for (const ConfigField& field : SCHEMA) {
+        if (fieldValue(a, field) != fieldValue(b, field)) return false;
+    }
+    return true;
+}
+
+// Все поля в диапазонах схемы и согласованы между собой.
+static bool configValid(const Config& config) {
+    for (const ConfigField& field : SCHEMA) {
+        double value;
+        if (field.type == FIELD_FLOAT) value = config.*field.real;
+        else if (field.type == FIELD_INT) value = config.*field.integer;
+        else continue;
+        if (!(value >= field.min && value <= field.max)) return false;
+    }
+    if (config.name_Player1.size() > 32 || config.name_Player2.size() > 32) return false;
+    return config.paddle_height <= config.field_height - 3 && config.ball_max_speed >= config.ball_speed;
+}
+
+int runConfigFuzz(long long iterations, uint64_t seed) {
+    using Clock = std::chrono::steady_clock;
+    static const char* const PROFILES[] = {"", "lan", "huge-field", "missing"};
+    std::string base = configText(Config()) +
+                       "\n[lan]\nspeed = 2\nframe_rate = 60\n"
+                       "\n[huge-field]\nfield_width = 400\nfield_height = 120\npaddle_height = 12\n";
+
+    Rng rng(seed);
+    ConfigFile file, again;
+    std::vector<std::string> errors;
+    long long reported = 0, failures = 0;
+    std::string firstFailure;
+
+    Clock::time_point start = Clock::now();
+    for (long long i = 0; i < iterations; i++) {
+        std::string text = base;
+        int mutations = 1 + rng.range(8);
+        for (int m = 0; m < mutations; m++) {
+            size_t at = text.empty() ? 0 : rng.range(static_cast<int>(text.size()));
+            switch (rng.range(5)) {
+                case 0:
+                    if (!text.empty()) text[at] = FUZZ_BYTES[rng.range(sizeof(FUZZ_BYTES) - 1)];
+                    break;
+                case 1:
+                    text.insert(at, std::string("\n") + FUZZ_LINES[rng.range(sizeof(FUZZ_LINES) / sizeof(FUZZ_LINES[0]))] + "\n");
+                    break;
+                case 2:
+                    text.erase(at, rng.range(40));
+                    break;
+                case 3:
+                    text.insert(at, text.substr(at, rng.range(40)));
+                    break;
+                case 4:
+                    text.resize(at);
+                    break;
+            }
+        }
+
+        const char* profile = PROFILES[rng.range(4)];
+        parseConfigText(text.data(), text.size(), file);
+        errors = file.errors;
+        Config config;
+        resolveConfig(file, profile, config, errors);
+        reported += static_cast<long long>(errors.size());
+
+        // Итог проверен, а запись и повторное чтение дают те же настройки без ошибок.
+        std::string written = configText(config);
+        parseConfigText(written.data(), written.size(), again);
+        errors = again.errors;
+        Config reread;
+        resolveConfig(again, "", reread, errors);
+
+        const char* failure = nullptr;
+        if (!configValid(config)) failure = "invalid config accepted";
+        else if (!errors.empty()) failure = "written config does not read back cleanly";
+        else if (!fieldsEqual(config, reread)) failure = "config changed after write and read";
+        if (!failure) continue;
+        failures++;
+        if (firstFailure.empty()) {
+            firstFailure = std::string(failure) + " (iteration " + std::to_string(i) + ", profile '" + profile +
+                           "')\n--- input ---\n" + text + "\n--- written ---\n" + written;
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf("inputs:         %lld\n", iterations);
+    printf("errors found:   %lld\n", reported);
+    printf("failures:       %lld\n", failures);
+    printf("time:           %.3f s\n", seconds);
+    printf("inputs/sec:     %.0f\n", seconds > 0 ? iterations / seconds : 0.0);
+    if (!firstFailure.empty()) printf("first failure:  %s\n", firstFailure.c_str());
+    return failures > 0 ? 1 : 0;
+}
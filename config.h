@@ -0,0 +1,93 @@
+#ifndef PONG_CONFIG_H
+#define PONG_CONFIG_H
+
+// Настройки из config.ini: разбор INI, схема ключей с типами и допустимыми диапазонами,
+// именованные профили и слежение за файлом для перезагрузки во время партии.
+//
+// Формат: "ключ = значение" по строке, комментарии с ';' или '#' в начале строки, пробелы
+// по краям ключа и значения отбрасываются (значение в кавычках сохраняет их). Строки до первого
+// заголовка — общий раздел; "[lan]", "[bench]" и т.п. — профили, которые поверх общего раздела
+// меняют только перечисленные в них ключи.
+
+#include "game.h"
+
+#include <string>
+#include <vector>
+
+struct ConfigEntry {
+    std::string key;
+    std::string value;
+    int line;
+};
+
+struct ConfigSection {
+    std::string name;  // Пусто — общий раздел.
+    std::vector<ConfigEntry> entries;
+};
+
+// Разобранный файл: разделы в порядке появления (общий всегда первый) и синтаксические ошибки.
+struct ConfigFile {
+    std::vector<ConfigSection> sections;
+    std::vector<std::string> errors;
+
+    const ConfigSection* find(const std::string& name) const;
+};
+
+// Разбор текста INI без проверки ключей и значений.
+void parseConfigText(const char* text, size_t size, ConfigFile& file);
+bool readConfigFile(const std::string& path, ConfigFile& file);
+
+// Настройки по умолчанию, поверх них общий раздел, затем раздел profile (пусто — без профиля).
+// Неизвестный ключ, не число или значение вне диапазона — сообщение в errors, поле остаётся прежним.
+// false, если профиля нет в файле.
+bool resolveConfig(const ConfigFile& file, const std::string& profile, Config& config,
+                   std::vector<std::string>& errors);
+
+// Согласование полей между собой (ракетка помещается на поле, предел скорости не ниже подачи).
+void validateConfig(Config& config, std::vector<std::string>& errors);
+
+// Все поля в пределах схемы и согласованы между собой, без исправлений — для настроек,
+// пришедших не из файла (по сети). Иначе false и причина в error.
+bool configInRange(const Config& config, std::string& error);
+
+// Файл целиком: разбор, профиль и проверка. Ошибки, если нужны, — в errors.
+Config loadConfig(const std::string& path, const std::string& profile = "", std::vector<std::string>* errors = nullptr);
+
+// Запись настроек. Без профиля пишется общий раздел; с профилем — в его раздел только то,
+// что отличается от общего. Остальные разделы файла сохраняются.
+bool saveConfig(const std::string& path, const Config& config, const std::string& profile = "");
+
+// Общий раздел со всеми ключами схемы.
+std::string configText(const Config& config);
+
+// Отличаются ли настройки, которые перезагрузка применяет к идущей партии:
+// скорость, высота ракетки и размер поля.
+bool liveSettingsDiffer(const Config& a, const Config& b);
+
+// Слежение за файлом настроек через inotify. Следит за каталогом: редакторы часто
+// сохраняют файл через переименование, и наблюдение за самим файлом теряется.
+class ConfigWatcher {
+private:
+    int fd;
+    std::string name;  // Имя файла внутри каталога.
+
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+public:
+    ConfigWatcher();
+    ~ConfigWatcher();
+
+    bool watch(const std::string& path);
+    // Был ли файл записан или заменён с прошлого вызова. Не блокирует и не выделяет память.
+    bool changed();
+};
+
+// Скорость разбора: config.ini и синтетический файл с тысячей профилей.
+int runConfigBenchmark(const std::string& path, long long iterations);
+
+// Случайные искажения файла настроек: разбор не падает, итог всегда проходит проверку
+// и переживает запись и повторное чтение без изменений. Возвращает код завершения процесса.
+int runConfigFuzz(long long iterations, uint64_t seed);
+
+#endif
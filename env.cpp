@@ -0,0 +1,444 @@
+#include "env.h"
+#include "modes.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <thread>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory counters must be lock-free");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared-memory counters must be lock-free");
+
+// Сид эпизода episode среды index: splitmix от общего сида, смещённого на номер среды и эпизода.
+static uint64_t episodeSeed(uint64_t seed, int index, uint64_t episode) {
+    Rng rng(seed + static_cast<uint64_t>(index) * 0xD1B54A32D192ED03ull + episode * 0x8CB92BA72F3D8DD7ull);
+    return rng.next();
+}
+
+PongEnv::PongEnv(const EnvOptions& options)
+    : options(options), agentCount(options.selfPlay ? 2 : 1), seed(0) {
+    if (this->options.count < 1) this->options.count = 1;
+    int count = this->options.count;
+    states.assign(count, newGame(options.config, options.selfPlay ? MODE_VERSUS : MODE_COMPUTER));
+    computers.assign(count, ComputerAI(options.opponent, 0));
+    episodes.assign(count, 0);
+    for (int i = 0; i < count; i++) startEpisode(i);
+}
+
+void PongEnv::startEpisode(int index) {
+    Rng rng(episodeSeed(seed, index, episodes[index]));
+    GameState& state = states[index];
+    state = newGame(options.config, options.selfPlay ? MODE_VERSUS : MODE_COMPUTER);
+    // Подача с случайной строки в случайную сторону: иначе все эпизоды начинались бы одинаково.
+    state.ball.setY(1 + rng.range(std::max(state.field_height - 2, 1)));
+    if (rng.range(2)) state.ball.invertXDirection();
+    if (rng.range(2)) state.ball.invertYDirection();
+    computers[index] = ComputerAI(options.opponent, rng.next());
+}
+
+void PongEnv::observe(int index, float* observations) const {
+    const GameState& state = states[index];
+    float width = static_cast<float>(state.field_width);
+    float height = static_cast<float>(state.field_height);
+    float maxScore = static_cast<float>(std::max(state.max_score, 1));
+    const float one = static_cast<float>(BALL_ONE);
+    float x = state.ball.getFixedX() / one, y = state.ball.getFixedY() / one;
+    float dx = state.ball.getDX() / one, dy = state.ball.getDY() / one;
+    float left = (state.player1.getY() + state.player1.getHeight() * 0.5f) / height;
+    float right = (state.player2.getY() + state.player2.getHeight() * 0.5f) / height;
+
+    float* out = observations + static_cast<size_t>(index) * agentCount * ENV_OBS_SIZE;
+    out[0] = x / width;
+    out[1] = y / height;
+    out[2] = dx;
+    out[3] = dy;
+    out[4] = left;
+    out[5] = right;
+    out[6] = state.player1Score / maxScore;
+    out[7] = state.player2Score / maxScore;
+    if (agentCount == 1) return;
+
+    // Правый агент: поле отражено относительно центра (колонки ракеток 1 и field_width - 2 меняются местами).
+    out += ENV_OBS_SIZE;
+    out[0] = (width - 1 - x) / width;
+    out[1] = y / height;
+    out[2] = -dx;
+    out[3] = dy;
+    out[4] = right;
+    out[5] = left;
+    out[6] = state.player2Score / maxScore;
+    out[7] = state.player1Score / maxScore;
+}
+
+void PongEnv::reset(uint64_t newSeed, float* observations) {
+    seed = newSeed;
+    for (int i = 0; i < options.count; i++) {
+        episodes[i] = 0;
+        startEpisode(i);
+        observe(i, observations);
+    }
+}
+
+// Действие агента как ввод на тик: всё, что не -1, 0 или 1, приводится к ближайшему.
+static int clampAction(int8_t action) {
+    return action < 0 ? -1 : action > 0 ? 1 : 0;
+}
+
+void PongEnv::step(const int8_t* actions, float* observations, float* rewards, uint8_t* dones) {
+    for (int i = 0; i < options.count; i++) {
+        GameState& state = states[i];
+        int score1 = state.player1Score, score2 = state.player2Score;
+        Inputs inputs;
+        inputs.player1 = clampAction(actions[i * agentCount]);
+        if (agentCount == 2) {
+            inputs.player2 = clampAction(actions[i * agentCount + 1]);
+            stepAs<Versus>(state, inputs);
+        } else {
+            inputs.player2 = VsComputer::computerMove(computers[i], state);
+            stepAs<VsComputer>(state, inputs);
+        }
+
+        float reward = static_cast<float>((state.player1Score - score1) - (state.player2Score - score2));
+        rewards[i * agentCount] = reward;
+        if (agentCount == 2) rewards[i * agentCount + 1] = -reward;
+        bool done = state.finished || (options.maxTicks > 0 && state.tick >= options.maxTicks);
+        dones[i] = done ? 1 : 0;
+        if (done) {
+            episodes[i]++;
+            startEpisode(i);
+        }
+        observe(i, observations);
+    }
+}
+
+// Ожидание на атомике: сначала вращение с pause (ответ обычно приходит за микросекунды),
+// потом уступка ядра, потом короткий сон, чтобы простаивающий сервер не занимал ядро целиком.
+// На одном ядре вращаться бессмысленно — вторая сторона не работает, пока мы крутимся.
+// alive() проверяется только на стадии сна, раз в сотню снов, так что быстрый ответ обходится
+// без системных вызовов; false — вторая сторона пропала, ждать нечего.
+template <class Ready, class Alive>
+static bool spinUntil(Ready ready, Alive alive) {
+    static const long long PAUSE_SPINS = std::thread::hardware_concurrency() > 1 ? 4096 : 0;
+    for (long long spins = 0; !ready(); spins++) {
+        if (spins < PAUSE_SPINS) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else if (spins < 65536) {
+            std::this_thread::yield();
+        } else {
+            if ((spins - 65536) % 100 == 0 && !alive()) return ready();
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    return true;
+}
+
+// Жив ли процесс pid. EPERM — процесс есть, но чужой.
+static bool processAlive(int32_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+// Буфер [offset, offset + bytes) лежит после заголовка и внутри отображения размера size.
+static bool bufferFits(uint64_t offset, uint64_t bytes, size_t size) {
+    return offset >= sizeof(EnvShmHeader) && offset <= size && bytes <= size - offset;
+}
+
+static size_t alignUp(size_t value) {
+    return (value + 63) & ~static_cast<size_t>(63);
+}
+
+static std::string shmName(const std::string& name) {
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+EnvShm::EnvShm() : header(nullptr), size(0), owner(false) {}
+
+EnvShm::~EnvShm() {
+    close();
+}
+
+bool EnvShm::create(const std::string& segment, int count, int agents) {
+    close();
+    name = shmName(segment);
+    size_t actions = alignUp(sizeof(EnvShmHeader));
+    size_t observations = actions + alignUp(static_cast<size_t>(agents) * count);
+    size_t rewards = observations + alignUp(sizeof(float) * agents * count * ENV_OBS_SIZE);
+    size_t dones = rewards + alignUp(sizeof(float) * agents * count);
+    size_t total = dones + alignUp(static_cast<size_t>(count));
+
+    // Сегмент с тем же именем мог остаться от упавшего сервера — он заменяется.
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) return false;
+    bool sized = ftruncate(fd, static_cast<off_t>(total)) == 0;
+    void* memory = sized ? mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    header = new (memory) EnvShmHeader();
+    size = total;
+    owner = true;
+    header->version = ENV_SHM_VERSION;
+    header->count = count;
+    header->agents = agents;
+    header->obsSize = ENV_OBS_SIZE;
+    header->serverPid = static_cast<int32_t>(getpid());
+    header->command = ENV_COMMAND_STEP;
+    header->seed = 0;
+    header->actionsOffset = actions;
+    header->observationsOffset = observations;
+    header->rewardsOffset = rewards;
+    header->donesOffset = dones;
+    header->size = total;
+    header->request.store(0, std::memory_order_relaxed);
+    header->response.store(0, std::memory_order_relaxed);
+    // magic — последним: клиент, увидевший его, видит и весь заголовок.
+    header->magic.store(ENV_SHM_MAGIC, std::memory_order_release);
+    return true;
+}
+
+bool EnvShm::open(const std::string& segment) {
+    close();
+    name = shmName(segment);
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) return false;
+    struct stat info;
+    void* memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(EnvShmHeader)) {
+        memory = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) return false;
+    header = static_cast<EnvShmHeader*>(memory);
+    size = info.st_size;
+    owner = false;
+    // Сегмент мог записать кто угодно: указатели на буферы выдаются, только если каждый
+    // буфер целиком лежит внутри отображения.
+    uint32_t magic = header->magic.load(std::memory_order_acquire);
+    bool valid = magic == ENV_SHM_MAGIC && header->version == ENV_SHM_VERSION && header->size <= size &&
+                 header->count > 0 && (header->agents == 1 || header->agents == 2) &&
+                 header->obsSize == ENV_OBS_SIZE;
+    if (valid) {
+        uint64_t agents = static_cast<uint64_t>(header->agents) * static_cast<uint64_t>(header->count);
+        valid = bufferFits(header->actionsOffset, agents, size) &&
+                bufferFits(header->observationsOffset, sizeof(float) * agents * ENV_OBS_SIZE, size) &&
+                bufferFits(header->rewardsOffset, sizeof(float) * agents, size) &&
+                bufferFits(header->donesOffset, static_cast<uint64_t>(header->count), size);
+    }
+    if (!valid) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool EnvShm::serverAlive() const {
+    return header && processAlive(header->serverPid);
+}
+
+void EnvShm::close() {
+    if (header) munmap(header, size);
+    if (header && owner) shm_unlink(name.c_str());
+    header = nullptr;
+    size = 0;
+    owner = false;
+}
+
+int8_t* EnvShm::actions() const {
+    return reinterpret_cast<int8_t*>(reinterpret_cast<char*>(header) + header->actionsOffset);
+}
+
+float* EnvShm::observations() const {
+    return reinterpret_cast<float*>(reinterpret_cast<char*>(header) + header->observationsOffset);
+}
+
+float* EnvShm::rewards() const {
+    return reinterpret_cast<float*>(reinterpret_cast<char*>(header) + header->rewardsOffset);
+}
+
+uint8_t* EnvShm::dones() const {
+    return reinterpret_cast<uint8_t*>(reinterpret_cast<char*>(header) + header->donesOffset);
+}
+
+int serveEnv(const std::string& name, const EnvOptions& options) {
+    PongEnv env(options);
+    EnvShm shm;
+    if (!shm.create(name, env.getCount(), env.getAgents())) {
+        fprintf(stderr, "Cannot create shared memory %s\n", name.c_str());
+        return 1;
+    }
+    EnvShmHeader* header = shm.getHeader();
+    env.reset(0, shm.observations());
+
+    uint64_t served = 0;
+    for (;;) {
+        // Сервер ждёт тренера сколько угодно: упавшего тренера может сменить новый.
+        spinUntil([&]() { return header->request.load(std::memory_order_acquire) != served; },
+                  []() { return true; });
+        served = header->request.load(std::memory_order_relaxed);
+        int command = header->command;
+        if (command == ENV_COMMAND_RESET) {
+            env.reset(header->seed, shm.observations());
+        } else if (command == ENV_COMMAND_STEP) {
+            env.step(shm.actions(), shm.observations(), shm.rewards(), shm.dones());
+        }
+        header->response.store(served, std::memory_order_release);
+        // Клиент закрывает сегмент после ответа; имя удаляет сервер при выходе.
+        if (command == ENV_COMMAND_CLOSE) return 0;
+    }
+}
+
+EnvClient::EnvClient() : sent(0) {}
+
+bool EnvClient::connect(const std::string& name, int timeoutMs) {
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    // Сегмент упавшего сервера остаётся под тем же именем; его не берём и ждём, пока новый сервер его заменит.
+    while (!shm.open(name) || !shm.serverAlive()) {
+        shm.close();
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    sent = shm.getHeader()->response.load(std::memory_order_acquire);
+    return true;
+}
+
+bool EnvClient::call(int command) {
+    EnvShmHeader* header = shm.getHeader();
+    if (!header) return false;
+    header->command = command;
+    header->request.store(++sent, std::memory_order_release);
+    return spinUntil([&]() { return header->response.load(std::memory_order_acquire) == sent; },
+                     [&]() { return shm.serverAlive(); });
+}
+
+bool EnvClient::reset(uint64_t seed) {
+    if (!shm.getHeader()) return false;
+    shm.getHeader()->seed = seed;
+    return call(ENV_COMMAND_RESET);
+}
+
+bool EnvClient::step() {
+    return call(ENV_COMMAND_STEP);
+}
+
+bool EnvClient::close() {
+    if (!shm.getHeader()) return false;
+    bool answered = call(ENV_COMMAND_CLOSE);
+    shm.close();
+    return answered;
+}
+
+// Политика бенчмарка: ракетка идёт к строке мяча (по наблюдению, как обучаемый агент).
+static void chaseBall(const float* observations, int8_t* actions, int agents, int count, int field_height) {
+    for (int k = 0; k < agents * count; k++) {
+        const float* obs = observations + static_cast<size_t>(k) * ENV_OBS_SIZE;
+        float rows = (obs[1] - obs[4]) * field_height;
+        actions[k] = rows > 0.5f ? 1 : rows < -0.5f ? -1 : 0;
+    }
+}
+
+// Итог прогона для сверки путей: сумма наград, число эпизодов и хэш последних наблюдений.
+struct EnvRun {
+    double seconds = 0;
+    double rewardSum = 0;
+    long long episodes = 0;
+    uint64_t hash = 1469598103934665603ull;
+
+    void add(const float* rewards, const uint8_t* dones, int agents, int count) {
+        for (int k = 0; k < agents * count; k++) rewardSum += rewards[k] * (k % agents == 0 ? 1 : 0);
+        for (int i = 0; i < count; i++) episodes += dones[i];
+    }
+
+    void finish(const float* observations, size_t size) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(observations);
+        for (size_t i = 0; i < size * sizeof(float); i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+};
+
+int runEnvBenchmark(const EnvOptions& options, long long steps, uint64_t seed) {
+    using Clock = std::chrono::steady_clock;
+    PongEnv env(options);
+    int count = env.getCount(), agents = env.getAgents();
+    long long batches = std::max(1LL, steps / count);
+    size_t obsSize = static_cast<size_t>(agents) * count * ENV_OBS_SIZE;
+    int field_height = options.config.field_height;
+
+    // В процессе: буферы вызывающего, как у тренера, который линкует libpongenv.a.
+    std::vector<float> observations(obsSize), rewards(static_cast<size_t>(agents) * count);
+    std::vector<int8_t> actions(static_cast<size_t>(agents) * count);
+    std::vector<uint8_t> dones(count);
+    EnvRun local;
+    env.reset(seed, observations.data());
+    Clock::time_point start = Clock::now();
+    for (long long b = 0; b < batches; b++) {
+        chaseBall(observations.data(), actions.data(), agents, count, field_height);
+        env.step(actions.data(), observations.data(), rewards.data(), dones.data());
+        local.add(rewards.data(), dones.data(), agents, count);
+    }
+    local.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    local.finish(observations.data(), obsSize);
+
+    // Через разделяемую память: сервер в дочернем процессе, этот процесс — тренер.
+    std::string name = "/pongenv-bench-" + std::to_string(getpid());
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (child == 0) _exit(serveEnv(name, options));
+    EnvClient client;
+    if (!client.connect(name, 5000)) {
+        fprintf(stderr, "Cannot connect to %s\n", name.c_str());
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+        return 1;
+    }
+    EnvRun remote;
+    bool answered = client.reset(seed);
+    start = Clock::now();
+    for (long long b = 0; answered && b < batches; b++) {
+        chaseBall(client.observations(), client.actions(), agents, count, field_height);
+        answered = client.step();
+        remote.add(client.rewards(), client.dones(), agents, count);
+    }
+    remote.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (!answered) {
+        fprintf(stderr, "Env server %s stopped responding\n", name.c_str());
+        client.close();
+        waitpid(child, nullptr, 0);
+        return 1;
+    }
+    remote.finish(client.observations(), obsSize);
+    client.close();
+    int childStatus = 0;
+    waitpid(child, &childStatus, 0);
+
+    bool same = local.hash == remote.hash && local.rewardSum == remote.rewardSum && local.episodes == remote.episodes;
+    long long total = batches * count;
+    printf("envs:           %d (%s, %d agent%s)\n", count,
+           options.selfPlay ? "self-play" : difficultyName(options.opponent), agents, agents > 1 ? "s" : "");
+    printf("env steps:      %lld (%lld batches)\n", total, batches);
+    printf("episodes:       %lld, reward sum %.0f\n", local.episodes, local.rewardSum);
+    printf("in-process:     %.0f steps/s, %.1f ns/step\n", local.seconds > 0 ? total / local.seconds : 0.0,
+           local.seconds * 1e9 / total);
+    printf("shared memory:  %.0f steps/s, %.1f ns/step, %.2f us/batch round trip\n",
+           remote.seconds > 0 ? total / remote.seconds : 0.0, remote.seconds * 1e9 / total,
+           remote.seconds * 1e6 / batches);
+    printf("result:         %s\n", same ? "identical" : "MISMATCH");
+    return same && WIFEXITED(childStatus) && WEXITSTATUS(childStatus) == 0 ? 0 : 1;
+}
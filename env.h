@@ -0,0 +1,170 @@
+#ifndef PONG_ENV_H
+#define PONG_ENV_H
+
+// Среда для обучения агентов ракетки: правила партии (Ball, Paddle, счёт — те же stepAs<>, что
+// у игры) без терминала, пачкой из N независимых партий. Собирается отдельно в libpongenv.a
+// (env.cpp, ai.cpp, game.cpp) и не тянет ncurses.
+//
+// Агент играет левой ракеткой. Правой — встроенный ComputerAI заданной сложности или,
+// в игре против себя (selfPlay), второй агент. Наблюдения второго агента отражены по горизонтали,
+// так что обе стороны видят поле «со своей ракеткой слева» и могут учить одну политику.
+//
+// Все буферы передаёт вызывающий: наблюдения — agents * N * ENV_OBS_SIZE float подряд
+// (среда за средой, внутри среды агент за агентом), действия и награды — agents * N,
+// флаги конца — N. Шаг не выделяет память и ничего не копирует, кроме записи в эти буферы.
+//
+// Конец эпизода — кто-то набрал max_score или прошло maxTicks тиков. На этом шаге done = 1,
+// награда содержит последнее очко, а среда сразу начинает новую партию, и в наблюдения
+// пишется её первое состояние (auto-reset).
+
+#include "ai.h"
+#include "game.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Наблюдение одного агента (в долях поля и клетках за тик):
+//   0, 1 — мяч x / field_width, y / field_height;
+//   2, 3 — скорость мяча по x и y, клеток за тик (x — к сопернику положительная);
+//   4    — центр своей ракетки / field_height;
+//   5    — центр ракетки соперника / field_height;
+//   6, 7 — свой счёт и счёт соперника / max_score.
+const int ENV_OBS_SIZE = 8;
+
+struct EnvOptions {
+    Config config;                          // Поле, ракетки, мяч и max_score — как в игре.
+    int count = 1;                          // Число сред в пачке.
+    bool selfPlay = false;                  // Правой ракеткой тоже управляет агент.
+    Difficulty opponent = DIFFICULTY_NORMAL;  // Сложность ComputerAI, если не selfPlay.
+    long long maxTicks = 0;                 // Предел длины эпизода в тиках, 0 — без предела.
+};
+
+class PongEnv {
+private:
+    EnvOptions options;
+    int agentCount;
+    uint64_t seed;
+    std::vector<GameState> states;
+    std::vector<ComputerAI> computers;
+    std::vector<uint64_t> episodes;  // Номер эпизода каждой среды — часть его сида.
+
+    void startEpisode(int index);
+    void observe(int index, float* observations) const;
+
+public:
+    explicit PongEnv(const EnvOptions& options);
+
+    int getCount() const { return options.count; }
+    int getAgents() const { return agentCount; }  // 1 или 2 (selfPlay).
+    const GameState& getState(int index) const { return states[index]; }
+
+    // Все среды с начала. Эпизод e среды i получает сид из (seed, i, e): одинаковый seed
+    // и одинаковые действия дают одинаковые партии при любом числе потоков и пачек.
+    void reset(uint64_t seed, float* observations);
+
+    // Один тик всех сред. actions: -1 вверх, 0 стоять, 1 вниз; rewards: +1 за своё очко,
+    // -1 за очко соперника; dones: 1, если эпизод среды закончился на этом тике.
+    void step(const int8_t* actions, float* observations, float* rewards, uint8_t* dones);
+};
+
+// Передача через разделяемую память для тренера в другом процессе на той же машине.
+// Сегмент shm_open(name): заголовок EnvShmHeader, затем буферы действий, наблюдений, наград
+// и флагов по смещениям из заголовка — тренер читает и пишет их на месте, без копий.
+// Запрос — запись command и увеличение request; сервер выполняет его и пишет response = request.
+// Обе стороны ждут, крутясь на атомиках, поэтому шаг не делает системных вызовов.
+// Долгое ожидание ответа изредка проверяет, жив ли процесс serverPid: тренер упавшего сервера
+// получает отказ, а не висит. Поэтому сервер и тренер должны видеть одно пространство PID.
+enum EnvCommand {
+    ENV_COMMAND_STEP = 0,
+    ENV_COMMAND_RESET = 1,  // Сид — в поле seed.
+    ENV_COMMAND_CLOSE = 2   // Сервер завершает serveEnv().
+};
+
+const uint32_t ENV_SHM_MAGIC = 0x564e4550;  // "PENV"
+const uint32_t ENV_SHM_VERSION = 2;
+
+struct EnvShmHeader {
+    std::atomic<uint32_t> magic;  // Пишется последним: сегмент готов.
+    uint32_t version;
+    int32_t count;
+    int32_t agents;
+    int32_t obsSize;
+    int32_t serverPid;            // Процесс сервера, для проверки, что он жив.
+    int32_t command;
+    uint64_t seed;
+    uint64_t actionsOffset;       // int8_t[agents * count]
+    uint64_t observationsOffset;  // float[agents * count * obsSize]
+    uint64_t rewardsOffset;       // float[agents * count]
+    uint64_t donesOffset;         // uint8_t[count]
+    uint64_t size;                // Размер сегмента целиком.
+    alignas(64) std::atomic<uint64_t> request;
+    alignas(64) std::atomic<uint64_t> response;
+};
+
+// Отображение сегмента в память процесса.
+class EnvShm {
+private:
+    std::string name;
+    EnvShmHeader* header;
+    size_t size;
+    bool owner;  // Создатель удаляет имя сегмента при закрытии.
+
+    EnvShm(const EnvShm&) = delete;
+    EnvShm& operator=(const EnvShm&) = delete;
+
+public:
+    EnvShm();
+    ~EnvShm();
+
+    bool create(const std::string& name, int count, int agents);
+    // Открытие чужого сегмента: заголовок и границы всех буферов проверяются по размеру отображения.
+    bool open(const std::string& name);
+    void close();
+    bool serverAlive() const;  // Процесс serverPid ещё существует.
+
+    EnvShmHeader* getHeader() const { return header; }
+    int8_t* actions() const;
+    float* observations() const;
+    float* rewards() const;
+    uint8_t* dones() const;
+};
+
+// Сервер: создаёт сегмент и выполняет запросы тренера, пока тот не пришлёт ENV_COMMAND_CLOSE.
+int serveEnv(const std::string& name, const EnvOptions& options);
+
+// Клиент тренера поверх EnvShm: действия пишутся в actions(), ответ читается из observations(),
+// rewards() и dones() того же сегмента.
+class EnvClient {
+private:
+    EnvShm shm;
+    uint64_t sent;
+
+    bool call(int command);  // false — сервер умер, не ответив.
+
+public:
+    EnvClient();
+
+    // Ожидание сервера до timeoutMs миллисекунд. Сегмент, чей сервер уже не жив, не подключается.
+    bool connect(const std::string& name, int timeoutMs);
+    int getCount() const { return shm.getHeader()->count; }
+    int getAgents() const { return shm.getHeader()->agents; }
+
+    int8_t* actions() const { return shm.actions(); }
+    const float* observations() const { return shm.observations(); }
+    const float* rewards() const { return shm.rewards(); }
+    const uint8_t* dones() const { return shm.dones(); }
+
+    // false — сервер упал или не подключён; буферы после этого не содержат ответа.
+    bool reset(uint64_t seed);
+    bool step();
+    bool close();  // Останавливает сервер.
+};
+
+// Бенчмарк: шаги сред в секунду в процессе и через разделяемую память с сервером
+// в дочернем процессе; проверка, что оба пути дают одинаковые партии.
+int runEnvBenchmark(const EnvOptions& options, long long steps, uint64_t seed);
+
+#endif
@@ -0,0 +1,82 @@
+#include "game.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Предел разгона в долях клетки. Не даёт мячу за один тик перелететь от одной ракетки дальше другой.
+static int maxBallSpeed(const Config& config, int speed) {
+    int limit = std::max(speed, static_cast<int>(std::lround(config.ball_max_speed * BALL_ONE)));
+    return std::min(limit, std::max(speed, (config.field_width - 4) * BALL_ONE / 2));
+}
+
+GameState newGame(const Config& config, int gameMode) {
+    GameState state{
+        gameMode,
+        config.field_width,
+        config.field_height,
+        config.max_score,
+        Paddle(1, config.field_height / 2 - config.paddle_height / 2, config.paddle_height),
+        Paddle(config.field_width - 2, config.field_height / 2 - config.paddle_height / 2, config.paddle_height),
+        Ball(config.field_width / 2, config.field_height / 2),
+        0,
+        0,
+        0,
+        false,
+        BallPhysics()
+    };
+
+    // Скорости из клеток за тик в доли клетки.
+    BallPhysics& physics = state.physics;
+    physics.speed = std::max(1, static_cast<int>(std::lround(config.ball_speed * BALL_ONE)));
+    physics.maxSpeed = maxBallSpeed(config, physics.speed);
+    physics.speedup = std::max(0, config.ball_speedup);
+    physics.spin = std::max(0, std::min(config.ball_spin, 100));
+    state.ball.setDX(physics.speed);
+    state.ball.setDY(physics.speed);
+    return state;
+}
+
+void resizeGame(GameState& state, const Config& config) {
+    state.field_width = config.field_width;
+    state.field_height = config.field_height;
+    for (Paddle* paddle : {&state.player1, &state.player2}) {
+        paddle->setHeight(config.paddle_height);
+        paddle->setY(std::max(1, std::min(paddle->getY(), config.field_height - 1 - config.paddle_height)));
+    }
+    state.player2.setX(config.field_width - 2);
+
+    // Поле могло сузиться: предел разгона и текущая скорость не больше нового предела.
+    BallPhysics& physics = state.physics;
+    physics.maxSpeed = maxBallSpeed(config, physics.speed);
+    Ball& ball = state.ball;
+    ball.setDX(std::max(-physics.maxSpeed, std::min(ball.getDX(), physics.maxSpeed)));
+    ball.setDY(std::max(-physics.maxSpeed, std::min(ball.getDY(), physics.maxSpeed)));
+
+    // Мяч между ракетками и стенами остаётся на месте, иначе — в центр поля.
+    int x = ball.getFixedX(), y = ball.getFixedY();
+    bool inside = x >= 2 * BALL_ONE && x <= (config.field_width - 3) * BALL_ONE &&
+                  y >= BALL_ONE && y <= (config.field_height - 2) * BALL_ONE;
+    if (!inside) {
+        ball.setX(config.field_width / 2);
+        ball.setY(config.field_height / 2);
+    } else {
+        ball.setFixedX(x);  // Путь за прошлый тик к новому полю не относится.
+        ball.setFixedY(y);
+    }
+}
+
+void step(GameState& state, const Inputs& inputs) {
+    moveBall(state);
+    movePaddles(state, inputs);
+    if (state.mode == MODE_WALL) returnFromWall(state);
+    hitPaddles(state);
+    if (state.mode == MODE_WALL) scoreWallMiss(state);
+    else scoreOutOfBounds(state);
+    finishTick(state);
+}
+
+int computerMove(const GameState& state, const Paddle& paddle) {
+    if (state.ball.getY() < paddle.getY()) return -1;
+    if (state.ball.getY() > paddle.getY() + paddle.getHeight()) return 1;
+    return 0;
+}
@@ -0,0 +1,336 @@
+#ifndef PONG_GAME_H
+#define PONG_GAME_H
+
+// Ядро симуляции игры без ввода-вывода: ни ncurses, ни файлов.
+// Одна партия целиком описывается GameState и продвигается вызовом step().
+
+#include <string>
+#include <cstdint>
+
+// Структура для хранения настроек игры (значения по умолчанию — для ключей, которых нет в config.ini)
+struct Config {
+    float speed = 1.0f;      // Скорость игры.
+    int max_score = 20;      // Максимальный счёт, при котором игра завершается.
+    int field_width = 100;   // Ширина игрового поля.
+    int field_height = 30;   // Высота игрового поля.
+    int paddle_height = 5;   // Высота ракетки игрока.
+    int frame_rate = 30; // Частота отрисовки (кадров в секунду), не влияет на физику.
+    int ai_difficulty = 1; // Сложность компьютера: 0 easy, 1 normal, 2 hard, 3 perfect.
+    std::string replay_dir = "replays"; // Каталог для повторов партий, пустая строка — не записывать.
+    float ball_speed = 1.0f;     // Скорость подачи, клеток за тик.
+    float ball_max_speed = 1.0f; // Предел разгона мяча, клеток за тик.
+    int ball_speedup = 0;        // Разгон за каждый удар ракеткой в розыгрыше, в процентах.
+    int ball_spin = 0;           // 0..100: влияние места удара о ракетку на угол отскока.
+    std::string name_Player1 = "Player 1";
+    std::string name_Player2 = "Player 2";
+};
+
+// Режимы игры (номера совпадают с пунктами главного меню).
+const int MODE_VERSUS = 1;    // Игрок против игрока.
+const int MODE_COMPUTER = 2;  // Игрок против компьютера.
+const int MODE_WALL = 3;      // Игрок против стены.
+
+// Класс для управления ракеткой
+class Paddle {
+private:
+    int x, y, height;  // Позиция и высота ракетки
+
+public:
+    Paddle(int x, int y, int height) : x(x), y(y), height(height) {}
+
+    // Методы доступа к полям
+    int getX() const { return x; }
+    int getY() const { return y; }
+    int getHeight() const { return height; }
+
+    // Методы установки значений полей
+    void setX(int newX) { x = newX; }
+    void setY(int newY) { y = newY; }
+    void setHeight(int newHeight) { height = newHeight; }
+
+    // Методы изменения значений полей
+    void addX(int dx) { x += dx; }
+    void addY(int dy) { y += dy; }
+
+    void moveUp() {
+        if (y > 1) y--;  // Перемещает ракетку вверх, если не достигнута граница
+    }
+
+    void moveDown(int field_height) {
+        if (y + height < field_height - 1) y++;  // Перемещает ракетку вниз, если не достигнута нижняя граница
+    }
+};
+
+// Мяч хранит позицию и скорость в фиксированной точке: BALL_ONE долей на клетку.
+// Классическая игра — частный случай со скоростью ровно в одну клетку за тик.
+const int BALL_SHIFT = 8;
+const int BALL_ONE = 1 << BALL_SHIFT;
+
+// Строка мяча (в долях клетки) после пути unfolded без учёта стен: мяч ходит между строками 1
+// и field_height - 2 и зеркально отражается от них, значит это треугольная волна с периодом 2 * span.
+inline int foldBallY(long long unfolded, int field_height) {
+    long long top = BALL_ONE;
+    long long span = static_cast<long long>(field_height - 3) * BALL_ONE;
+    if (span <= 0) return static_cast<int>(top);
+    long long period = 2 * span;
+    long long phase = ((unfolded - top) % period + period) % period;
+    return static_cast<int>(top + (phase <= span ? phase : period - phase));
+}
+
+// Параметры полёта мяча на партию (в долях клетки за тик).
+struct BallPhysics {
+    int speed = BALL_ONE;         // Скорость подачи по горизонтали и вертикали.
+    int maxSpeed = BALL_ONE;      // Предел разгона.
+    int speedup = 0;              // Прибавка скорости за удар ракеткой, в процентах.
+    int spin = 0;                 // 0..100: насколько место удара о ракетку задаёт угол отскока.
+};
+
+// Класс для управления мячом
+class Ball {
+private:
+    int x, y;          // Позиция мяча в долях клетки
+    int dx, dy;        // Скорость мяча: доли клетки за тик
+    int fromX, fromY;  // Начало пути за последний тик — для проверки пересечения с ракетками
+    int travelY;       // Путь по вертикали за последний тик без учёта отражений
+
+    // Строка, на которой путь за тик пересекает колонку planeX.
+    int crossingY(int planeX, int field_height) const {
+        long long part = static_cast<long long>(travelY) * (planeX - fromX) / (x - fromX);
+        return foldBallY(fromY + part, field_height);
+    }
+
+public:
+    Ball(int x, int y)
+        : x(x * BALL_ONE), y(y * BALL_ONE), dx(BALL_ONE), dy(BALL_ONE),
+          fromX(x * BALL_ONE), fromY(y * BALL_ONE), travelY(0) {}
+
+    // Клетка, в которой мяч рисуется.
+    int getX() const { return x >> BALL_SHIFT; }
+    int getY() const { return y >> BALL_SHIFT; }
+    // Точная позиция и скорость в долях клетки.
+    int getFixedX() const { return x; }
+    int getFixedY() const { return y; }
+    int getDX() const { return dx; }
+    int getDY() const { return dy; }
+
+    void setX(int newX) { x = fromX = newX * BALL_ONE; }
+    void setY(int newY) { y = fromY = newY * BALL_ONE; }
+    void setFixedX(int newX) { x = fromX = newX; }
+    void setFixedY(int newY) { y = fromY = newY; }
+    void setDX(int newDX) { dx = newDX; }
+    void setDY(int newDY) { dy = newDY; }
+
+    void invertXDirection() {
+        dx = -dx;
+    }
+
+    void invertYDirection() {
+        dy = -dy;
+    }
+
+    void move() {
+        fromX = x;
+        fromY = y;
+        travelY = dy;
+        x += dx;  // Изменение позиции мяча на скорость за тик
+        y += dy;
+    }
+
+    // Зеркальное отражение от верхней и нижней стен; касание стены тоже разворачивает мяч.
+    void bounce(int field_height) {
+        int top = BALL_ONE, bottom = (field_height - 2) * BALL_ONE;
+        if (bottom <= top) {
+            y = top;
+            return;
+        }
+        for (;;) {
+            if (y < top || (y == top && dy < 0)) {
+                y = 2 * top - y;
+                dy = -dy;
+            } else if (y > bottom || (y == bottom && dy > 0)) {
+                y = 2 * bottom - y;
+                dy = -dy;
+            } else {
+                break;
+            }
+        }
+    }
+
+    // Пересёк ли путь за тик колонку ракетки в пределах её высоты. Проверяется весь отрезок,
+    // поэтому мяч не проскакивает ракетку ни на какой скорости.
+    bool checkPaddleCollision(const Paddle& paddle, int field_height) const {
+        int plane = paddle.getX() * BALL_ONE;
+        bool crossed = dx < 0 ? fromX > plane && x <= plane : dx > 0 && fromX < plane && x >= plane;
+        if (!crossed) return false;
+        int row = crossingY(plane, field_height);
+        return row >= paddle.getY() * BALL_ONE && row < (paddle.getY() + paddle.getHeight()) * BALL_ONE;
+    }
+
+    // Отскок от ракетки: зеркально от её колонки, с разгоном и углом по месту удара.
+    void bounceOffPaddle(const Paddle& paddle, int field_height, const BallPhysics& physics) {
+        int plane = paddle.getX() * BALL_ONE;
+        int row = crossingY(plane, field_height);
+        x = 2 * plane - x;
+        fromX = plane;
+        fromY = row;
+        travelY = y - row;
+
+        int speed = dx < 0 ? -dx : dx;
+        int faster = speed + speed * physics.speedup / 100;
+        if (faster > physics.maxSpeed) faster = speed > physics.maxSpeed ? speed : physics.maxSpeed;
+        dx = dx < 0 ? faster : -faster;
+        dy = static_cast<int>(static_cast<long long>(dy) * faster / speed);
+        if (physics.spin > 0) {
+            // Удар краем ракетки — до 45 градусов, серединой — прямо.
+            int half = paddle.getHeight() * BALL_ONE / 2;
+            int offset = row - (paddle.getY() * BALL_ONE + half);
+            long long angled = static_cast<long long>(offset) * faster / half;
+            dy = static_cast<int>((static_cast<long long>(dy) * (100 - physics.spin) + angled * physics.spin) / 100);
+        }
+    }
+
+    // Отражение от вертикальной стены в колонке column (игра против стены).
+    void bounceOffColumn(int column) {
+        int plane = column * BALL_ONE;
+        if (x < plane || (x == plane && dx < 0)) {
+            x = 2 * plane - x;
+            fromX = plane;
+            dx = -dx;
+        }
+    }
+
+    bool outOfBounds(int field_width) const {
+        return x <= 0 || x >= (field_width - 1) * BALL_ONE;  // Проверка, находится ли мяч за границей игрового поля
+    }
+
+    // Подача из клетки (startX, startY) в сторону, противоположную прежней, со скоростью speed.
+    void reset(int startX, int startY, int speed) {
+        x = fromX = startX * BALL_ONE;  // Сбрасывает позицию мяча в центр
+        y = fromY = startY * BALL_ONE;
+        travelY = 0;
+        dx = dx > 0 ? -speed : speed;  // Меняет направление мяча
+        dy = dy < 0 ? -speed : speed;
+    }
+};
+
+// Детерминированный генератор случайных чисел (splitmix64) для сидов партий и ботов.
+struct Rng {
+    uint64_t state;
+
+    explicit Rng(uint64_t seed = 0) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Равномерное число в [0, n).
+    int range(int n) { return static_cast<int>(next() % static_cast<uint64_t>(n)); }
+};
+
+// Ввод на один тик: на сколько строк сдвинуть ракетку (< 0 вверх, > 0 вниз).
+struct Inputs {
+    int player1 = 0;
+    int player2 = 0;
+};
+
+// Полное состояние одной партии.
+struct GameState {
+    int mode;             // MODE_VERSUS, MODE_COMPUTER или MODE_WALL.
+    int field_width;
+    int field_height;
+    int max_score;
+    Paddle player1;
+    Paddle player2;
+    Ball ball;
+    int player1Score;
+    int player2Score;
+    long long tick;       // Номер текущего тика.
+    bool finished;        // Кто-то набрал max_score.
+    BallPhysics physics;  // Из настроек; за партию меняется только предел разгона в resizeGame().
+};
+
+// Начальное состояние партии по настройкам.
+GameState newGame(const Config& config, int gameMode);
+
+// Новый размер поля и высота ракеток из config посреди партии (перезагрузка настроек).
+// Ракетки остаются в своих строках, насколько позволяет поле; мяч, оказавшийся за новыми
+// границами, переносится в центр с прежней скоростью. Счёт и тик не меняются.
+void resizeGame(GameState& state, const Config& config);
+
+// Части тика. step() собирает из них тик, проверяя режим партии;
+// stepAs<Mode>() из modes.h собирает тот же тик под режим, известный при компиляции.
+
+// Сдвиг ракетки на заданное число строк с учётом границ поля.
+inline void movePaddle(Paddle& paddle, int rows, int field_height) {
+    for (; rows < 0; rows++) paddle.moveUp();
+    for (; rows > 0; rows--) paddle.moveDown(field_height);
+}
+
+// Обновление позиции мяча и удар о стены сверху и снизу.
+inline void moveBall(GameState& state) {
+    state.ball.move();
+    state.ball.bounce(state.field_height);
+}
+
+// Применение ввода за этот тик.
+inline void movePaddles(GameState& state, const Inputs& inputs) {
+    movePaddle(state.player1, inputs.player1, state.field_height);
+    movePaddle(state.player2, inputs.player2, state.field_height);
+}
+
+// Игра против стены: мяч отражается от стены в колонке 2, левая ракетка стоит за ней.
+inline void returnFromWall(GameState& state) {
+    if (state.ball.checkPaddleCollision(state.player1, state.field_height)) {
+        state.ball.bounceOffPaddle(state.player1, state.field_height, state.physics);
+    }
+    state.ball.bounceOffColumn(2);
+}
+
+// Проверка на столкновение с ракетками.
+inline void hitPaddles(GameState& state) {
+    Ball& ball = state.ball;
+    if (ball.checkPaddleCollision(state.player1, state.field_height)) {
+        ball.bounceOffPaddle(state.player1, state.field_height, state.physics);
+    } else if (ball.checkPaddleCollision(state.player2, state.field_height)) {
+        ball.bounceOffPaddle(state.player2, state.field_height, state.physics);
+    }
+}
+
+// Счёт идёт после ракеток: быстрый мяч может за тик и пересечь колонку ракетки, и выйти за край поля.
+// Мяч за левым или правым краем — очко сопернику и подача из центра.
+inline void scoreOutOfBounds(GameState& state) {
+    Ball& ball = state.ball;
+    if (!ball.outOfBounds(state.field_width)) return;
+    if (ball.getFixedX() <= 0) state.player2Score++;
+    else state.player1Score++;
+    ball.reset(state.field_width / 2, state.field_height / 2, state.physics.speed);
+}
+
+// Против стены: промах правой ракетки считается очком player1.
+inline void scoreWallMiss(GameState& state) {
+    Ball& ball = state.ball;
+    if (ball.getFixedX() < (state.field_width - 1) * BALL_ONE) return;
+    state.player1Score++;
+    ball.reset(state.field_width / 2, state.field_height / 2, state.physics.speed);
+    ball.invertXDirection();
+}
+
+// Проверка на завершение игры и переход к следующему тику.
+inline void finishTick(GameState& state) {
+    if (state.player1Score >= state.max_score || state.player2Score >= state.max_score) {
+        state.finished = true;
+    }
+    state.tick++;
+}
+
+// Один тик физики: мяч, ввод, столкновения, счёт. Режим проверяется на каждом тике;
+// там, где режим известен заранее, быстрее stepAs<Mode>() из modes.h.
+void step(GameState& state, const Inputs& inputs);
+
+// Ход компьютера за ракетку paddle: догоняет мяч по вертикали.
+int computerMove(const GameState& state, const Paddle& paddle);
+
+#endif
@@ -0,0 +1,396 @@
+#include "headless.h"
+#include "modes.h"
+#include "pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+// Бот: догоняет мяч как компьютер, но иногда отвлекается,
+// иначе партии двух идеальных ботов длились бы бесконечно.
+static int botMove(const GameState& state, const Paddle& paddle, Rng& rng) {
+    if (rng.range(4) == 0) return 0;  // Пропуск хода.
+    if (state.ball.getY() < paddle.getY()) return -1;
+    if (state.ball.getY() >= paddle.getY() + paddle.getHeight()) return 1;
+    return 0;
+}
+
+// Игрок-ИИ одной стороны партии.
+struct SideAi {
+    AiType type;
+    Rng rng;
+    ComputerAI computer;
+
+    SideAi(AiType type, uint64_t seed)
+        : type(type), rng(seed),
+          computer(type >= AI_EASY ? static_cast<Difficulty>(type - AI_EASY) : DIFFICULTY_NORMAL, seed) {}
+
+    int move(const GameState& state, const Paddle& paddle) {
+        if (type == AI_BOT) return botMove(state, paddle, rng);
+        if (type == AI_CHASE) return computerMove(state, paddle);
+        return computer.move(state, paddle);
+    }
+};
+
+// Партия без терминала в режиме Mode: обе ракетки ведут ИИ из описания.
+template <class Mode>
+static MatchResult playMatchAs(const MatchSpec& spec) {
+    GameState state = newGame(*spec.config, Mode::id);
+    Rng seeds(spec.seed);
+    SideAi player1(spec.player1, seeds.next());
+    SideAi player2(spec.player2, seeds.next());
+    Inputs inputs;
+
+    while (!state.finished && state.tick < spec.maxTicks) {
+        inputs.player1 = player1.move(state, state.player1);
+        inputs.player2 = player2.move(state, state.player2);
+        stepAs<Mode>(state, inputs);
+    }
+    return MatchResult{state.player1Score, state.player2Score, state.tick, state.finished};
+}
+
+MatchResult playMatch(const MatchSpec& spec) {
+    return withMode(spec.mode, [&](auto mode) { return playMatchAs<decltype(mode)>(spec); });
+}
+
+MatchResult playMatchBranchy(const MatchSpec& spec) {
+    GameState state = newGame(*spec.config, spec.mode);
+    Rng seeds(spec.seed);
+    SideAi player1(spec.player1, seeds.next());
+    SideAi player2(spec.player2, seeds.next());
+    Inputs inputs;
+
+    while (!state.finished && state.tick < spec.maxTicks) {
+        inputs.player1 = player1.move(state, state.player1);
+        inputs.player2 = player2.move(state, state.player2);
+        step(state, inputs);
+    }
+    return MatchResult{state.player1Score, state.player2Score, state.tick, state.finished};
+}
+
+void MatchTotals::add(const MatchSpec& spec, const MatchResult& result) {
+    matches++;
+    ticks += result.ticks;
+    if (!result.finished) unfinished++;
+    else if (result.player1Score > result.player2Score) player1Wins++;
+    else player2Wins++;
+
+    // Хеш итога партии вместе с её сидом; сумма хешей не зависит от порядка.
+    Rng mix(spec.seed ^ (static_cast<uint64_t>(result.ticks) << 16)
+            ^ (static_cast<uint64_t>(result.player1Score) << 8) ^ static_cast<uint64_t>(result.player2Score));
+    checksum += mix.next();
+}
+
+void MatchTotals::merge(const MatchTotals& other) {
+    matches += other.matches;
+    player1Wins += other.player1Wins;
+    player2Wins += other.player2Wins;
+    unfinished += other.unfinished;
+    ticks += other.ticks;
+    checksum += other.checksum;
+}
+
+namespace {
+
+// Буфер итогов одного потока, на отдельной кэш-линии.
+struct alignas(64) WorkerTotals {
+    MatchTotals totals;
+};
+
+}
+
+MatchTotals runMatches(const std::vector<MatchSpec>& specs, int threads, std::vector<MatchResult>* results) {
+    if (results) results->assign(specs.size(), MatchResult());
+
+    std::vector<WorkerTotals> buffers(threads > 0 ? threads : 1);
+    runWorkStealing(threads, static_cast<int>(specs.size()), [&](int task, int worker) {
+        MatchResult result = playMatch(specs[task]);
+        buffers[worker].totals.add(specs[task], result);
+        if (results) (*results)[task] = result;
+    });
+
+    MatchTotals totals;
+    for (const WorkerTotals& buffer : buffers) totals.merge(buffer.totals);
+    return totals;
+}
+
+bool parseModeName(const std::string& name, int& mode) {
+    if (name == "versus") mode = MODE_VERSUS;
+    else if (name == "computer") mode = MODE_COMPUTER;
+    else if (name == "wall") mode = MODE_WALL;
+    else return false;
+    return true;
+}
+
+static const char* modeName(int mode) {
+    if (mode == MODE_VERSUS) return "versus";
+    if (mode == MODE_WALL) return "wall";
+    return "computer";
+}
+
+// Серия партий одним потоком: runMatches() мерил бы пул, а здесь сравниваются циклы.
+static MatchTotals playSeries(const std::vector<MatchSpec>& specs, MatchResult (*play)(const MatchSpec&),
+                              double& seconds) {
+    using Clock = std::chrono::steady_clock;
+    MatchTotals totals;
+    Clock::time_point start = Clock::now();
+    for (const MatchSpec& spec : specs) totals.add(spec, play(spec));
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return totals;
+}
+
+// Против стены ИИ почти не промахивается, поэтому партии в бенчмарке обрезаются.
+const long long MODE_BENCH_MAX_TICKS = 20000;
+
+int runModeBenchmark(const Config& config, const HeadlessOptions& options) {
+    long long maxTicks = std::min(options.maxTicks, MODE_BENCH_MAX_TICKS);
+    printf("matches: %d per mode, max ticks %lld, %s vs %s, one thread\n", options.matches, maxTicks,
+           aiTypeName(options.player1), aiTypeName(options.player2));
+    printf("%-9s %12s %14s %14s %9s  %s\n", "mode", "ticks", "branchy t/s", "policy t/s", "speedup", "result");
+    int status = 0;
+    for (int mode : {MODE_VERSUS, MODE_COMPUTER, MODE_WALL}) {
+        std::vector<MatchSpec> specs;
+        for (int i = 0; i < options.matches; i++) {
+            specs.push_back(MatchSpec{&config, options.seed + i, options.player1, options.player2, maxTicks, mode});
+        }
+        // Пути чередуются, берётся лучшее из трёх: так меньше сказываются прогрев и частота процессора.
+        double branchySeconds = 0, policySeconds = 0, seconds;
+        MatchTotals branchy, policy;
+        for (int run = 0; run < 3; run++) {
+            branchy = playSeries(specs, playMatchBranchy, seconds);
+            if (run == 0 || seconds < branchySeconds) branchySeconds = seconds;
+            policy = playSeries(specs, playMatch, seconds);
+            if (run == 0 || seconds < policySeconds) policySeconds = seconds;
+        }
+        bool same = branchy.checksum == policy.checksum && branchy.ticks == policy.ticks;
+        if (!same) status = 1;
+        printf("%-9s %12lld %14.0f %14.0f %8.2fx  %s\n", modeName(mode), policy.ticks,
+               branchySeconds > 0 ? branchy.ticks / branchySeconds : 0.0,
+               policySeconds > 0 ? policy.ticks / policySeconds : 0.0,
+               policySeconds > 0 ? branchySeconds / policySeconds : 0.0, same ? "identical" : "MISMATCH");
+    }
+    return status;
+}
+
+bool parseAiType(const std::string& name, AiType& type) {
+    Difficulty difficulty;
+    if (name == "bot") type = AI_BOT;
+    else if (name == "chase") type = AI_CHASE;
+    else if (name == "computer") type = AI_NORMAL;
+    else if (parseDifficulty(name, difficulty)) type = static_cast<AiType>(AI_EASY + difficulty);
+    else return false;
+    return true;
+}
+
+const char* aiTypeName(AiType type) {
+    if (type == AI_BOT) return "bot";
+    if (type == AI_CHASE) return "chase";
+    return difficultyName(static_cast<Difficulty>(type - AI_EASY));
+}
+
+double aiCostPerTick(const Config& config, AiType type) {
+    using Clock = std::chrono::steady_clock;
+    const int samples = 200000;
+
+    // Записываем последовательные состояния настоящей партии (без лимита по счёту),
+    // чтобы кэш ИИ работал так же, как в игре.
+    Config endless = config;
+    endless.max_score = 1 << 30;
+    GameState state = newGame(endless, MODE_COMPUTER);
+    SideAi player1(AI_BOT, 1), player2(AI_CHASE, 2);
+    std::vector<GameState> states;
+    states.reserve(samples);
+    Inputs inputs;
+    for (int i = 0; i < samples; i++) {
+        states.push_back(state);
+        inputs.player1 = player1.move(state, state.player1);
+        inputs.player2 = player2.move(state, state.player2);
+        step(state, inputs);
+    }
+
+    SideAi ai(type, 3);
+    int sink = 0;
+    Clock::time_point start = Clock::now();
+    for (const GameState& s : states) sink += ai.move(s, s.player2);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    volatile int keep = sink;  // Не даём компилятору выбросить цикл.
+    (void)keep;
+    return seconds * 1e9 / samples;
+}
+
+int runHeadless(const Config& config, const HeadlessOptions& options) {
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<MatchSpec> specs;
+    for (int i = 0; i < options.matches; i++) {
+        specs.push_back(MatchSpec{&config, options.seed + i, options.player1, options.player2, options.maxTicks, options.mode});
+    }
+    int threads = options.threads > 0 ? options.threads : defaultThreadCount();
+
+    Clock::time_point start = Clock::now();
+    MatchTotals totals = runMatches(specs, threads);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf("matches:        %d\n", totals.matches);
+    printf("player 1 wins:  %d\n", totals.player1Wins);
+    printf("player 2 wins:  %d\n", totals.player2Wins);
+    printf("unfinished:     %d\n", totals.unfinished);
+    printf("ticks:          %lld (%.1f per match)\n", totals.ticks,
+           totals.matches > 0 ? static_cast<double>(totals.ticks) / totals.matches : 0.0);
+    printf("threads:        %d\n", threads);
+    printf("time:           %.3f s\n", seconds);
+    printf("ticks/sec:      %.0f\n", seconds > 0 ? totals.ticks / seconds : 0.0);
+    printf("checksum:       %016llx\n", static_cast<unsigned long long>(totals.checksum));
+    printf("ai cost:        player 1 %s %.1f ns/tick, player 2 %s %.1f ns/tick\n",
+           aiTypeName(options.player1), aiCostPerTick(config, options.player1),
+           aiTypeName(options.player2), aiCostPerTick(config, options.player2));
+
+    if (options.scaling) {
+        // Кривая масштабирования: та же серия на 1..threads потоках.
+        printf("\nthreads  time(s)   matches/s     ticks/s   speedup  efficiency  checksum\n");
+        double baseline = 0;
+        for (int t = 1; t <= threads; t++) {
+            Clock::time_point begin = Clock::now();
+            MatchTotals run = runMatches(specs, t);
+            double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+            if (t == 1) baseline = elapsed;
+            double speedup = elapsed > 0 ? baseline / elapsed : 0.0;
+            printf("%7d  %7.3f  %10.0f  %10.0f  %7.2fx  %9.0f%%  %016llx%s\n", t, elapsed,
+                   elapsed > 0 ? run.matches / elapsed : 0.0, elapsed > 0 ? run.ticks / elapsed : 0.0,
+                   speedup, 100.0 * speedup / t, static_cast<unsigned long long>(run.checksum),
+                   run.checksum == totals.checksum ? "" : "  MISMATCH");
+            if (run.checksum != totals.checksum) return 1;
+        }
+    }
+    return 0;
+}
+
+// Итоги одного потока проверки физики.
+struct FuzzTotals {
+    long long steps = 0;
+    long long hits = 0;        // Тиков с пересечением ракетки.
+    long long tunnels = 0;     // Мяч прошёл сквозь ракетку.
+    long long escapes = 0;     // Мяч оказался за стеной или позади ракетки без гола.
+};
+
+const long long FUZZ_TASK_STEPS = 1 << 20;  // Тиков в одной задаче пула.
+const int FUZZ_TICKS_PER_STATE = 64;        // Сколько тиков играется из одного случайного состояния.
+
+// Пересекает ли путь мяча за тик колонку ракетки внутри неё (с запасом margin долей клетки).
+// Считается в double независимо от step(): параметр пересечения, затем отражения от стен.
+static bool crossesInside(const GameState& before, const Paddle& paddle, double margin) {
+    const Ball& ball = before.ball;
+    if (ball.getDX() == 0) return false;
+    double plane = static_cast<double>(paddle.getX()) * BALL_ONE;
+    double t = (plane - ball.getFixedX()) / ball.getDX();
+    if (t <= 0 || t > 1) return false;
+    double top = BALL_ONE, span = static_cast<double>(before.field_height - 3) * BALL_ONE;
+    double phase = std::fmod(ball.getFixedY() + ball.getDY() * t - top, 2 * span);
+    if (phase < 0) phase += 2 * span;
+    double row = top + (phase <= span ? phase : 2 * span - phase);
+    return row >= paddle.getY() * BALL_ONE + margin && row < (paddle.getY() + paddle.getHeight()) * BALL_ONE - margin;
+}
+
+// Случайная партия с мячом в случайном месте между ракетками.
+static GameState fuzzState(Rng& rng) {
+    Config config;
+    config.speed = 1.0f;
+    config.max_score = 1 << 30;
+    config.field_width = 12 + rng.range(189);
+    config.field_height = 6 + rng.range(55);
+    config.paddle_height = 1 + rng.range(std::min(10, config.field_height - 3));
+    config.ball_speed = (16 + rng.range(4 * BALL_ONE)) / static_cast<float>(BALL_ONE);
+    config.ball_max_speed = config.ball_speed + rng.range(8 * BALL_ONE) / static_cast<float>(BALL_ONE);
+    config.ball_speedup = rng.range(51);
+    config.ball_spin = rng.range(101);
+    GameState state = newGame(config, 1 + rng.range(3));
+
+    int w = state.field_width, h = state.field_height, left = state.mode == MODE_WALL ? 2 : 1;
+    int speed = 1 + rng.range(state.physics.maxSpeed);
+    state.ball.setFixedX((left * BALL_ONE + 1) + rng.range((w - 2 - left) * BALL_ONE - 1));
+    state.ball.setFixedY(BALL_ONE + rng.range((h - 3) * BALL_ONE + 1));
+    state.ball.setDX(rng.range(2) ? speed : -speed);
+    state.ball.setDY(rng.range(2 * state.physics.maxSpeed + 1) - state.physics.maxSpeed);
+    state.player1.setY(1 + rng.range(h - 1 - config.paddle_height));
+    state.player2.setY(1 + rng.range(h - 1 - config.paddle_height));
+    return state;
+}
+
+static std::string describe(const char* what, const GameState& before, const GameState& after) {
+    char text[256];
+    snprintf(text, sizeof(text), "%s: field %dx%d mode %d, ball (%d,%d) v (%d,%d) -> (%d,%d) v (%d,%d), "
+             "paddles %d/%d height %d (1/%d cell units)", what, before.field_width, before.field_height,
+             before.mode, before.ball.getFixedX(), before.ball.getFixedY(), before.ball.getDX(), before.ball.getDY(),
+             after.ball.getFixedX(), after.ball.getFixedY(), after.ball.getDX(), after.ball.getDY(),
+             after.player1.getY(), after.player2.getY(), after.player1.getHeight(), BALL_ONE);
+    return text;
+}
+
+int runPhysicsFuzz(long long steps, uint64_t seed, int threads) {
+    using Clock = std::chrono::steady_clock;
+    if (threads <= 0) threads = defaultThreadCount();
+    int tasks = static_cast<int>((steps + FUZZ_TASK_STEPS - 1) / FUZZ_TASK_STEPS);
+
+    std::vector<FuzzTotals> perWorker(threads);
+    std::mutex reportMutex;
+    std::string firstFailure;
+
+    Clock::time_point start = Clock::now();
+    runWorkStealing(threads, tasks, [&](int task, int worker) {
+        FuzzTotals& totals = perWorker[worker];
+        Rng rng(seed * 0x9E3779B97F4A7C15ull + static_cast<uint64_t>(task));
+        long long count = std::min(FUZZ_TASK_STEPS, steps - task * FUZZ_TASK_STEPS);
+        GameState state = fuzzState(rng);
+        for (long long i = 0; i < count; i++) {
+            if (i % FUZZ_TICKS_PER_STATE == 0) state = fuzzState(rng);
+            GameState before = state;
+            Inputs inputs;
+            inputs.player1 = rng.range(3) - 1;
+            inputs.player2 = rng.range(3) - 1;
+            step(state, inputs);
+            totals.steps++;
+
+            const char* failure = nullptr;
+            bool scored = state.player1Score != before.player1Score || state.player2Score != before.player2Score;
+            // В игре против стены левая ракетка закрыта стеной в колонке 2.
+            const Paddle* paddles[2] = {before.mode == MODE_WALL ? nullptr : &state.player1, &state.player2};
+            for (const Paddle* paddle : paddles) {
+                if (!paddle || !crossesInside(before, *paddle, 2)) continue;
+                totals.hits++;
+                if (scored || (state.ball.getDX() > 0) == (before.ball.getDX() > 0)) failure = "tunneling";
+            }
+            int x = state.ball.getFixedX(), y = state.ball.getFixedY();
+            int left = (before.mode == MODE_WALL ? 2 : 0) * BALL_ONE;
+            if (y < BALL_ONE || y > (state.field_height - 2) * BALL_ONE) failure = "escaped through a wall";
+            else if (!scored && (x < left || x > (state.field_width - 1) * BALL_ONE)) failure = "escaped the field";
+            if (!failure) continue;
+
+            if (failure[0] == 't') totals.tunnels++;
+            else totals.escapes++;
+            std::lock_guard<std::mutex> lock(reportMutex);
+            if (firstFailure.empty()) firstFailure = describe(failure, before, state);
+        }
+    });
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    FuzzTotals totals;
+    for (const FuzzTotals& t : perWorker) {
+        totals.steps += t.steps;
+        totals.hits += t.hits;
+        totals.tunnels += t.tunnels;
+        totals.escapes += t.escapes;
+    }
+    printf("steps:          %lld (%lld random states)\n", totals.steps,
+           (totals.steps + FUZZ_TICKS_PER_STATE - 1) / FUZZ_TICKS_PER_STATE);
+    printf("paddle hits:    %lld\n", totals.hits);
+    printf("tunneling:      %lld\n", totals.tunnels);
+    printf("escapes:        %lld\n", totals.escapes);
+    printf("threads:        %d\n", threads);
+    printf("time:           %.3f s\n", seconds);
+    printf("steps/sec:      %.0f\n", seconds > 0 ? totals.steps / seconds : 0.0);
+    if (!firstFailure.empty()) printf("first failure:  %s\n", firstFailure.c_str());
+    return totals.tunnels + totals.escapes > 0 ? 1 : 0;
+}
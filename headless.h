@@ -0,0 +1,98 @@
+#ifndef PONG_HEADLESS_H
+#define PONG_HEADLESS_H
+
+// Партии без терминала на максимальной скорости, в том числе параллельно на всех ядрах.
+// Используется для регрессионной проверки ИИ и физики.
+
+#include "ai.h"
+#include "game.h"
+
+#include <vector>
+
+// Кто управляет ракеткой в безголовой партии.
+enum AiType {
+    AI_BOT = 0,       // Догоняет мяч, но иногда пропускает ход.
+    AI_CHASE = 1,     // Прежний компьютер: каждый тик сравнивает строку мяча и ракетки.
+    AI_EASY = 2,      // ComputerAI с предсказанием траектории, по уровням сложности.
+    AI_NORMAL = 3,
+    AI_HARD = 4,
+    AI_PERFECT = 5
+};
+
+// Описание одной партии: всё, что нужно, чтобы сыграть её независимо от остальных.
+struct MatchSpec {
+    const Config* config;
+    uint64_t seed;
+    AiType player1;
+    AiType player2;
+    long long maxTicks;  // Лимит тиков на партию (защита от бесконечного розыгрыша).
+    int mode = MODE_COMPUTER;  // Правила партии; обе ракетки всё равно ведут ИИ.
+};
+
+// Итог одной безголовой партии.
+struct MatchResult {
+    int player1Score;
+    int player2Score;
+    long long ticks;
+    bool finished;   // false, если партия упёрлась в лимит тиков.
+};
+
+// Сводка по серии партий.
+struct MatchTotals {
+    int matches = 0;
+    int player1Wins = 0;
+    int player2Wins = 0;
+    int unfinished = 0;
+    long long ticks = 0;
+    uint64_t checksum = 0;  // Не зависит от порядка партий: совпадает при любом числе потоков.
+
+    void add(const MatchSpec& spec, const MatchResult& result);
+    void merge(const MatchTotals& other);
+};
+
+struct HeadlessOptions {
+    int matches = 1000;                 // Сколько партий сыграть.
+    uint64_t seed = 1;                  // Сид первой партии, далее seed + номер партии.
+    long long maxTicks = 1000000;       // Лимит тиков на партию.
+    AiType player1 = AI_BOT;
+    AiType player2 = AI_NORMAL;
+    int threads = 0;                    // 0 — по числу ядер.
+    bool scaling = false;               // Прогнать серию на 1..threads потоках и вывести кривую масштабирования.
+    int mode = MODE_COMPUTER;           // Правила партий (MODE_*).
+};
+
+// Одна партия по описанию: цикл, собранный под режим spec.mode (см. modes.h).
+MatchResult playMatch(const MatchSpec& spec);
+
+// Та же партия прежним циклом через step(), который проверяет режим на каждом тике.
+// Эталон для runModeBenchmark().
+MatchResult playMatchBranchy(const MatchSpec& spec);
+
+// Партии на пуле потоков с кражей работы. Каждый поток копит итоги в собственном буфере
+// без блокировок, буферы сливаются в конце. results (если задан) получает итоги в порядке specs.
+MatchTotals runMatches(const std::vector<MatchSpec>& specs, int threads, std::vector<MatchResult>* results = nullptr);
+
+// Серия партий с отчётом в stdout. Возвращает код завершения процесса.
+int runHeadless(const Config& config, const HeadlessOptions& options);
+
+// Скорость тиков в каждом режиме: прежний цикл со step() против цикла, собранного под режим.
+// Итоги обоих путей сверяются; партии обрезаются до 20000 тиков. Возвращает код завершения процесса.
+int runModeBenchmark(const Config& config, const HeadlessOptions& options);
+
+// Разбор режима для командной строки: "versus", "computer", "wall". false, если имя неизвестно.
+bool parseModeName(const std::string& name, int& mode);
+
+// Разбор имени ИИ для командной строки: "bot", "chase", уровень сложности или "computer"
+// (то же, что "normal"). false, если имя неизвестно.
+bool parseAiType(const std::string& name, AiType& type);
+const char* aiTypeName(AiType type);
+
+// Проверка физики мяча на steps случайных тиках: случайные поля, скорости, разгон и подкрутка.
+// Каждый тик сверяется с точным расчётом пересечения колонок ракеток; если мяч прошёл сквозь
+// ракетку или вылетел за стены, печатается первый такой случай. Возвращает код завершения процесса.
+int runPhysicsFuzz(long long steps, uint64_t seed, int threads);
+
+// Процессорное время одного хода ИИ в наносекундах, измеренное на записанной партии.
+double aiCostPerTick(const Config& config, AiType type);
+
+#endif
@@ -3,17 +3,37 @@
 #include <fstream>      // Для работы с файлами (чтение и запись).
 #include <string>       // Для работы со строками.
 #include <cstring> 
-
-// Структура для хранения настроек игры
-struct Config {
-    float speed;         // Скорость игры.
-    int max_score;       // Максимальный счёт, при котором игра завершается.
-    int field_width;     // Ширина игрового поля.
-    int field_height;    // Высота игрового поля.
-    int paddle_height;   // Высота ракетки игрока.
-    std::string name_Player1;
-    std::string name_Player2;
-};
+#include <chrono>       // Монотонные часы для фиксированного шага симуляции.
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "ai.h"
+#include "alloc.h"
+#include "arena.h"
+#include "batch.h"
+#include "config.h"
+#include "env.h"
+#include "game.h"
+#include "headless.h"
+#include "modes.h"
+#include "multiball.h"
+#include "net.h"
+#include "pool.h"
+#include "profile.h"
+#include "render.h"
+#include "replay.h"
+#include "scorelog.h"
+#include "spectate.h"
+#include "stats.h"
+#include "tournament.h"
 
 void initColors() {
     start_color();
@@ -27,150 +47,58 @@ void centeredPrint(int y, const char *text, int width) {
     mvprintw(y, x, "%s", text);
 }
 
-// Функция для загрузки конфигурации из файла config.ini
-Config loadConfig(const std::string& fileName) {
-    Config config;
-    std::ifstream file(fileName);   // Открытие файла для чтения
-    if (file.is_open()) {           // Проверка успешного открытия файла
-        std::string line;
-        while (std::getline(file, line)) {  // Чтение каждой строки из файла
-            // Поиск параметров и запись их значений в соответствующие поля структуры
-            if (line.find("speed") != std::string::npos) config.speed = std::stof(line.substr(line.find("=") + 1));
-            if (line.find("max_score") != std::string::npos) config.max_score = std::stoi(line.substr(line.find("=") + 1));
-            if (line.find("field_width") != std::string::npos) config.field_width = std::stoi(line.substr(line.find("=") + 1));
-            if (line.find("field_height") != std::string::npos) config.field_height = std::stoi(line.substr(line.find("=") + 1));
-            if (line.find("paddle_height") != std::string::npos) config.paddle_height = std::stoi(line.substr(line.find("=") + 1));
-            if (line.find("name_Player1") != std::string::npos) config.name_Player1 = line.substr(line.find("=") + 1);
-            if (line.find("name_Player2") != std::string::npos) config.name_Player2 = line.substr(line.find("=") + 1);
-
-        }
-        file.close();  // Закрытие файла
-    }
-    return config;  // Возвращение структуры с загруженными параметрами
-}
-
-// Функция для сохранения конфигурации
-void saveConfig(const std::string& fileName, Config& config) {
-    std::ofstream file(fileName);   // Открытие файла для записи
-    if (file.is_open()) {           // Проверка успешного открытия файла
-        // Запись каждого параметра из структуры `config` в файл
-        file << "speed = " << config.speed << std::endl;
-        file << "max_score = " << config.max_score << std::endl;
-        file << "field_width = " << config.field_width << std::endl;
-        file << "field_height = " << config.field_height << std::endl;
-        file << "paddle_height = " << config.paddle_height << std::endl;
-        file << "name_Player1 = " << config.name_Player1 << std::endl;
-        file << "name_Player2 = " << config.name_Player2 << std::endl;
-        file.close();  // Закрытие файла
-    }
-}
-
-// Класс для управления ракеткой
-// Класс для управления ракеткой
-class Paddle {
-private:
-    int x, y, height;  // Позиция и высота ракетки
-
-public:
-    Paddle(int x, int y, int height) : x(x), y(y), height(height) {}
-
-    // Методы доступа к полям
-    int getX() const { return x; }
-    int getY() const { return y; }
-    int getHeight() const { return height; }
-
-    // Методы установки значений полей
-    void setX(int newX) { x = newX; }
-    void setY(int newY) { y = newY; }
-    void setHeight(int newHeight) { height = newHeight; }
-
-    // Методы изменения значений полей
-    void addX(int dx) { x += dx; }
-    void addY(int dy) { y += dy; }
-
-    void moveUp() {
-        if (y > 1) y--;  // Перемещает ракетку вверх, если не достигнута граница
-    }
-
-    void moveDown(int field_height) {
-        if (y + height < field_height - 1) y++;  // Перемещает ракетку вниз, если не достигнута нижняя граница
-    }
-
-    void draw() const {
-        for (int i = 0; i < height; i++) {
-            mvprintw(y + i, x, "|");  // Отрисовка ракетки вертикальной чертой на позиции `x`, `y`
-        }
-    }
-};
-
-// Класс для управления мячом
-class Ball {
-private:
-    int x, y;     // Позиция мяча
-    int dx, dy;   // Направление мяча
-
-public:
-    Ball(int x, int y) : x(x), y(y), dx(1), dy(1) {}
-
-    int getX() const { return x; }
-    int getY() const { return y; }
-    int getDX() const { return dx; }
-    int getDY() const { return dy; }
-
-    void setX(int newX) { x = newX; }
-    void setY(int newY) { y = newY; }
-    void setDX(int newDX) { dx = newDX; }
-    void setDY(int newDY) { dy = newDY; }
-
-    void addX(int dxIncrement) { x += dxIncrement; }
-    void addY(int dyIncrement) { y += dyIncrement; }
-
-    void invertXDirection() {
-        dx = -dx;
-    }
-
-    void invertYDirection() {
-        dy = -dy;
-    }
-
-    void move() {
-        x += dx;  // Изменение позиции мяча в направлении `dx`
-        y += dy;  // Изменение позиции мяча в направлении `dy`
-    }
-
-    void bounce(int field_height) {
-        if (y <= 1 || y >= field_height - 2) {
-            dy = -dy;  // Меняет направление мяча при столкновении с верхней или нижней границей
+// Файл настроек и профиль (--profile), из которых загружена игра; в них же пишет меню настроек
+// и за ними следит перезагрузка во время партии.
+static const std::string configPath = "config.ini";
+static std::string configProfile;
+static ConfigWatcher configWatcher;
+
+// Журнал и таблица лидеров открываются один раз на всё время работы игры: партия дописывается
+// в открытый журнал и учитывается в таблице за O(1). Снимок scores.stats пишется лениво —
+// перед показом таблицы и при выходе; отставший снимок всё равно догоняется по журналу.
+static ScoreLog scoreLog;
+static Leaderboard leaderboard;
+static bool leaderboardLoaded = false;
+static bool leaderboardDirty = false;
+
+// Таблица лидеров в памяти, догнанная до журнала: первый раз — снимок плюс хвост журнала,
+// дальше — только записи, дописанные другими процессами (турнир, второй экземпляр игры).
+static bool syncLeaderboard(ScoreLogReader& reader) {
+    if (leaderboardLoaded && reader.open()) {
+        uint64_t before = leaderboard.getApplied();
+        if (leaderboard.catchUp(reader)) {
+            leaderboardDirty = leaderboardDirty || leaderboard.getApplied() != before;
+            return true;
         }
     }
+    // Первый раз или журнал пересоздан (он короче таблицы): снимок и пересчёт.
+    leaderboardLoaded = openLeaderboard(leaderboard, reader);
+    leaderboardDirty = false;
+    return leaderboardLoaded;
+}
 
-    void draw() const {
-        mvprintw(y, x, "O");  // Отрисовка мяча на экране символом `O`
-    }
+static void saveLeaderboard() {
+    if (leaderboardDirty && leaderboard.save("scores.stats")) leaderboardDirty = false;
+}
 
-    bool checkPaddleCollision(const Paddle& paddle) const {
-        return (x == paddle.getX() && y >= paddle.getY() && y < paddle.getY() + paddle.getHeight());
+// Функция для сохранения результатов в журнал scores.bin
+void saveScore(const std::string& playerName_1, int score_1, const std::string& playerName_2, int score_2, int gameMode) {
+    if (!scoreLog.isOpen() && !scoreLog.open()) return;  // Проверка успешного открытия
+    if (!leaderboardLoaded) {
+        ScoreLogReader reader;
+        syncLeaderboard(reader);
     }
-
-    bool outOfBounds(int field_width) const {
-        return x <= 0 || x >= field_width - 1;  // Проверка, находится ли мяч за границей игрового поля
+    uint64_t index = scoreLog.getCount();
+    ScoreRecord record;
+    if (!scoreLog.append(ScoreEntry{playerName_1, score_1, playerName_2, score_2, gameMode,
+                                    static_cast<int64_t>(time(nullptr))}, &record)) {
+        return;
     }
-
-    void reset(int startX, int startY) {
-        x = startX;  // Сбрасывает позицию мяча в центр
-        y = startY;
-        dx = -dx;  // Меняет направление мяча
-    }
-};
-
-
-
-// Функция для сохранения результатов в файл scores.txt
-void saveScore(const std::string& playerName_1, int score_1, const std::string& playerName_2, int score_2) {
-    std::ofstream file("scores.txt", std::ios::app);  // Открываем файл в режиме добавления
-    if (file.is_open()) {  // Проверка успешного открытия
-        file << playerName_1 << " - " << score_1 << " " << playerName_2 << " - " << score_2 << std::endl;  // Запись имени игрока и счёта
-        file.close();  // Закрытие файла
+    // Запись легла сразу за учтёнными — учитываем её; иначе кто-то дописал журнал между партиями,
+    // и таблица догонит его при следующем показе.
+    if (leaderboardLoaded && leaderboard.getApplied() == index) {
+        leaderboard.apply(record);
+        leaderboardDirty = true;
     }
 }
 
@@ -188,6 +116,8 @@ void settingsMenu(Config& config) {
         "Change paddle height",
         "Change name Player 1",
         "Change name Player 2",
+        "Change frame rate",
+        "Change AI difficulty",
         "Save and exit"
     };
     int num_options = sizeof(options) / sizeof(options[0]); // Количество опций.
@@ -263,39 +193,141 @@ void settingsMenu(Config& config) {
                         config.name_Player2 = buffer;
                         noecho();
                         break;
-                    case 7: // Сохранение настроек и выход из меню.
-                        saveConfig("config.ini", config);
+                    case 7: // Изменение частоты отрисовки.
+                        mvprintw(10, 5, "Enter frame rate (FPS): ");
+                        echo();
+                        scanw("%d", &config.frame_rate);
+                        noecho();
+                        break;
+                    case 8: // Смена сложности компьютера по кругу.
+                        config.ai_difficulty = (config.ai_difficulty + 1) % 4;
+                        mvprintw(10, 5, "AI difficulty: %s ", difficultyName(static_cast<Difficulty>(config.ai_difficulty)));
+                        getch();
+                        break;
+                    case 9: // Сохранение настроек и выход из меню.
+                        // Повторное чтение отбрасывает введённые значения вне допустимых диапазонов.
+                        saveConfig(configPath, config, configProfile);
+                        config = loadConfig(configPath, configProfile);
                         return;
                 }
         }
     }
 }
 
-// Функция отображения результатов, сохраненных в файле.
+// Функция отображения результатов из журнала.
+// Журнал отображается в память один раз при входе, дальше клавиши только листают его.
 void showResults() {
+    ScoreLogReader reader;
+    bool opened = reader.open();
+    std::string error = "Unable to open scores file.";
+    if (!opened) {
+        // Журнала ещё нет: создаём его, заодно перенося старый scores.txt.
+        ScoreLog log;
+        opened = log.open() && reader.open();
+        if (!log.getError().empty()) error = log.getError();
+    }
+
+    long count = opened ? static_cast<long>(reader.getCount()) : 0;
+    int pageSize = std::max(LINES - 4, 1);
+    long first = std::max(count - pageSize, 0L);  // Сначала показываем последние партии.
     int ch;
     while (true) {
         erase(); // Очистка экрана перед перерисовкой.
 
-        std::ifstream file("scores.txt");
-        if (file.is_open()) {
-            std::string line;
-            int i = 0;
-            while (std::getline(file, line)) {
-                mvprintw(1 + i, 5, "%s", line.c_str()); // Показ каждой строки результата.
-                i++;
+        if (opened) {
+            for (int i = 0; i < pageSize && first + i < count; i++) {
+                const ScoreRecord& record = reader.record(first + i);
+                if (!reader.valid(first + i)) {
+                    mvprintw(1 + i, 5, "%6ld  <damaged record>", first + i + 1);
+                    continue;
+                }
+                char date[32] = "imported";
+                if (record.timestamp != 0) {
+                    time_t when = static_cast<time_t>(record.timestamp);
+                    strftime(date, sizeof(date), "%Y-%m-%d %H:%M", localtime(&when));
+                }
+                // Показ каждого результата.
+                mvprintw(1 + i, 5, "%6ld  %-16s  %s - %d  %s - %d", first + i + 1, date,
+                         reader.name(record.player1).c_str(), record.score1,
+                         reader.name(record.player2).c_str(), record.score2);
             }
-            file.close();
-
-            mvprintw(i + 2, 5, "Press 'Q' to return to menu."); // Инструкция для возврата.
-            refresh(); // Обновление экрана для отображения текста.
+            // Инструкция для возврата.
+            mvprintw(pageSize + 2, 5, "%ld-%ld of %ld. Up/Down, PgUp/PgDn, Home/End to scroll, 'Q' to return to menu.",
+                     count > 0 ? first + 1 : 0, std::min(first + pageSize, count), count);
         } else {
-            mvprintw(1, 5, "Error: Unable to open scores file.");
+            mvprintw(1, 5, "Error: %s", error.c_str());
             mvprintw(3, 5, "Press 'Q' to return to menu.");
         }
+        refresh(); // Обновление экрана для отображения текста.
 
-        // Ожидание ввода для выхода из меню.
+        // Ожидание ввода: листание или выход из меню.
         ch = getch(); // Ввод с клавиатуры
+        long last = std::max(count - pageSize, 0L);
+        switch (ch) {
+            case KEY_UP: first = std::max(first - 1, 0L); break;
+            case KEY_DOWN: first = std::min(first + 1, last); break;
+            case KEY_PPAGE: first = std::max(first - pageSize, 0L); break;
+            case KEY_NPAGE: first = std::min(first + pageSize, last); break;
+            case KEY_HOME: first = 0; break;
+            case KEY_END: first = last; break;
+        }
+        if (ch == 'q' || ch == 'Q') {
+            break;
+        }
+    }
+}
+
+// Таблица лидеров: лучшие игроки по рейтингу и поиск игрока по имени.
+void showLeaderboard() {
+    ScoreLogReader reader;
+    bool opened = syncLeaderboard(reader);
+    saveLeaderboard();
+    const Leaderboard& board = leaderboard;
+    std::string lookup;  // Имя игрока, найденного через '/'.
+    int ch;
+
+    while (true) {
+        erase();
+        if (opened) {
+            int rows = std::max(LINES - 7, 1);
+            std::vector<uint32_t> best = board.top(rows);
+            mvprintw(1, 5, "%4s  %-20s %6s %6s %6s %8s %8s %8s", "#", "name", "wins", "losses", "draws", "for", "against", "rating");
+            for (size_t i = 0; i < best.size(); i++) {
+                const PlayerStats& p = *board.find(best[i]);
+                mvprintw(2 + i, 5, "%4zu  %-20s %6u %6u %6u %8llu %8llu %8.1f", i + 1, reader.name(best[i]).c_str(),
+                         p.wins, p.losses, p.draws, static_cast<unsigned long long>(p.pointsFor),
+                         static_cast<unsigned long long>(p.pointsAgainst), p.rating);
+            }
+            if (!lookup.empty()) {
+                const PlayerStats* found = nullptr;
+                const std::vector<std::string>& names = reader.getNames();
+                for (uint32_t id = 0; id < names.size() && !found; id++) {
+                    if (names[id] == lookup) found = board.find(id);
+                }
+                if (found) {
+                    mvprintw(rows + 3, 5, "%s: %u wins, %u losses, %u draws, %llu:%llu points, rating %.1f", lookup.c_str(),
+                             found->wins, found->losses, found->draws, static_cast<unsigned long long>(found->pointsFor),
+                             static_cast<unsigned long long>(found->pointsAgainst), found->rating);
+                } else {
+                    mvprintw(rows + 3, 5, "%s: no matches", lookup.c_str());
+                }
+            }
+            mvprintw(rows + 4, 5, "Press '/' to find a player, 'Q' to return to menu.");
+        } else {
+            mvprintw(1, 5, "Error: Unable to open scores file.");
+            mvprintw(3, 5, "Press 'Q' to return to menu.");
+        }
+        refresh();
+
+        ch = getch();
+        if (ch == '/' && opened) {
+            char buffer[50];
+            mvprintw(LINES - 1, 5, "Player name: ");
+            echo();
+            getnstr(buffer, sizeof(buffer) - 1);
+            noecho();
+            lookup = buffer;
+        }
         if (ch == 'q' || ch == 'Q') {
             break;
         }
@@ -311,6 +343,7 @@ int showMenu() {
         "Play: Player vs Computer",
         "Play: Player vs Wall",
         "Show Results",
+        "Leaderboard",
         "Settings",
         "Exit"
     };
@@ -351,123 +384,902 @@ int showMenu() {
 }
 
 
-void gameLoop(Config& config, int gameMode) {
-    int player1Score = 0, player2Score = 0;
+// Цикл с фиксированным шагом: onTick() вызывается с частотой 10 * speed Гц (как прежний timeout(100 / speed)),
+// onRender() — не чаще frameRate раз в секунду, независимо от физики и скорости нажатий.
+// speed читается на каждой итерации: перезагрузка настроек меняет его посреди партии.
+// Весь накопившийся ввод выбирается без блокировки и передаётся в onKey() перед тиками.
+template <class KeyFn, class TickFn, class RenderFn>
+void fixedStepLoop(const float& speed, int frameRate, bool& isRunning, KeyFn onKey, TickFn onTick, RenderFn onRender) {
+    using Clock = std::chrono::steady_clock;
+    const Clock::duration frameStep = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / std::max(frameRate, 1)));
+    const Clock::duration maxFrameTime = std::chrono::milliseconds(250); // Ограничение догоняющих тиков после паузы.
+    const double frameStepNs = std::chrono::duration<double, std::nano>(frameStep).count();
+    (void)frameStepNs;  // Не используется, если профилировщик выключен при сборке.
 
-    // Инициализация объектов Paddle и Ball с новыми аргументами, если они изменились
-    Paddle player1(1, config.field_height / 2 - config.paddle_height / 2, config.paddle_height);
-    Paddle player2(config.field_width - 2, config.field_height / 2 - config.paddle_height / 2, config.paddle_height);
-    
-    Ball ball(config.field_width / 2, config.field_height / 2);
+    timeout(0);  // Неблокирующий getch() для выборки ввода пачкой.
 
-    bool isRunning = true;
-    nodelay(stdscr, TRUE);  // Включение неблокирующего режима.
-    timeout(100 / config.speed); // Установка скорости игры.
+    Clock::time_point previous = Clock::now();
+    Clock::time_point nextFrame = previous;
+    Clock::duration accumulator = Clock::duration::zero();
 
     while (isRunning) {
-        erase(); // Очистка экрана.
-
-        // Рисование границ поля.
-        for (int i = 0; i < config.field_width; i++) {
-            mvprintw(0, i, "-");
-            mvprintw(config.field_height - 1, i, "-");
+        const Clock::duration tickStep = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(0.1 / std::max(speed, 0.01f)));
+        Clock::time_point now = Clock::now();
+        Clock::duration elapsed = now - previous;
+        previous = now;
+        if (elapsed > maxFrameTime) elapsed = maxFrameTime;
+        accumulator += elapsed;
+
+        // Выборка всего накопившегося ввода без блокировки.
+        int ch;
+        {
+            PROFILE_SCOPE(PHASE_INPUT);
+            while ((ch = getch()) != ERR) {
+                onKey(ch);
+            }
         }
-        if (gameMode == 3) {
-            for (int i = 1; i < config.field_height - 1; i++) {
-                mvprintw(i, 1, "|");
+
+        // Столько тиков, сколько набежало реального времени.
+        {
+            PROFILE_SCOPE(PHASE_SIM);
+            while (isRunning && accumulator >= tickStep) {
+                onTick();
+                accumulator -= tickStep;
             }
         }
 
-        // Обновление позиции и проверка столкновений мяча
-        ball.move();
-        ball.bounce(config.field_height);  // Удар о стены сверху и снизу
-        player1.draw();
-        player2.draw();
-        ball.draw();
+        if (now >= nextFrame) {
+            PROFILE_FRAME(frameStepNs);
+            onRender();
+            nextFrame += frameStep;
+            if (nextFrame < now) nextFrame = now + frameStep;  // Не догоняем пропущенные кадры.
+        }
 
-        // Отображение счёта
-        mvprintw(1, config.field_width / 2 - 5, "Score: %d | %d", player1Score, player2Score);
+        // Ожидание до ближайшего тика или кадра; нажатие клавиши прерывает ожидание.
+        Clock::time_point wake = std::min(now + (tickStep - accumulator), nextFrame);
+        // Округление вверх: остаток меньше миллисекунды иначе превращался в холостое вращение цикла.
+        long waitMs = std::chrono::ceil<std::chrono::milliseconds>(wake - Clock::now()).count();
+        if (isRunning && waitMs > 0) {
+            timeout(static_cast<int>(waitMs));
+            ch = getch();
+            if (ch != ERR) ungetch(ch);
+            timeout(0);
+        }
+    }
+    timeout(-1);  // Меню и результаты снова ждут нажатия, а не крутятся вхолостую.
+}
 
-        // Отображение имени игрока 1
-        mvprintw(2, 0, "%s", config.name_Player1.c_str());
+// Оверлей профилировщика под полем: по строке на фазу кадра.
+void drawProfileOverlay(FrameBuffer& frame, int row) {
+    char text[96];
+    if (!PROFILE_ENABLED) {
+        frame.print(row, 0, "Profiling is compiled out (make PROFILE=0).");
+        return;
+    }
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        profiler.describe(static_cast<ProfilePhase>(phase), text, sizeof(text));
+        frame.print(row + phase, 0, text);
+    }
+}
+
+// Имя файла повтора для новой партии: <replay_dir>/<дата-время>-<режим>.pongrpl
+std::string replayPath(const Config& config, int gameMode) {
+    mkdir(config.replay_dir.c_str(), 0755);
+    char name[64];
+    time_t now = time(nullptr);
+    strftime(name, sizeof(name), "%Y%m%d-%H%M%S", localtime(&now));
+    return config.replay_dir + "/" + name + "-" + std::to_string(gameMode) + ".pongrpl";
+}
+
+// Трансляция партий зрителям (--broadcast); если не запущена, publish() ничего не делает.
+static SpectatorServer spectators;
+
+// Память партий в терминале: запись повтора и всё, что копится по тикам. Сбрасывается
+// в начале каждой партии, блоки переиспользуются, поэтому тики не вызывают operator new.
+static MatchArena matchArena;
+
+// Партия режима Mode без ввода-вывода: тик и кадр в буфере. Её играет терминальный цикл
+// и она же проверяется --check-alloc. Перед созданием нужно сбросить matchArena.
+template <class Mode>
+struct LocalMatch {
+    GameState state;
+    Inputs pending;  // Накопленный ввод, применяется на ближайшем тике.
+    ComputerAI computer;
+    bool recording;
+    ReplayRecorder recorder;
+    MatchLabels labels;
+    CachedText output;
+    Viewport view;                   // Видимая часть поля.
+    int screenWidth, screenHeight;   // Место под поле в терминале.
+
+    LocalMatch(const Config& config, uint64_t aiSeed)
+        : state(newGame(config, Mode::id)), computer(static_cast<Difficulty>(config.ai_difficulty), aiSeed),
+          recording(!config.replay_dir.empty()), recorder(matchArena), output("Out: %lld cells, %lld bytes/frame") {
+        // Запись повтора: ввод людей по тикам, ходы компьютера восстанавливаются из сида.
+        if (recording) recorder.begin(config, Mode::id, config.ai_difficulty, aiSeed);
+        fitView(config, config.field_width, config.field_height);
+    }
+
+    // Окно на поле под место width x height; поле больше — видно окно, которое следует за мячом.
+    // Подписи ставятся по ширине окна.
+    void fitView(const Config& config, int width, int height) {
+        screenWidth = width;
+        screenHeight = height;
+        view = Viewport::fit(state.field_width, state.field_height, width, height);
+        labels.setPlayers(config.name_Player1, Mode::opponentName(config), view.width);
+    }
 
-        // Логика для отображения имени игрока 2 или "Computer" в зависимости от режима
-        if (gameMode == 1) {
-            mvprintw(2, config.field_width - size(config.name_Player2)-4, "%s", config.name_Player2.c_str());
-        } else if (gameMode == 2) {
-            mvprintw(2, config.field_width - 12, "Computer");
+    // Один тик физики: ввод игроков плюс ход компьютера (только в режиме против компьютера).
+    void tick() {
+        if (recording) recorder.record(state, pending, computer);
+        pending.player2 += Mode::computerMove(computer, state);
+        stepAs<Mode>(state, pending);
+        pending = Inputs();
+        spectators.publish(state);
+    }
+
+    // Новое поле из перезагруженных настроек на границе тиков: запись в повтор, физика, подписи.
+    void resize(const Config& config) {
+        if (recording) recorder.recordResize(state, config);
+        resizeGame(state, config);
+        fitView(config, screenWidth, screenHeight);
+    }
+
+    // Кадр: окно на поле, под ним строка со счётчиком вывода за предыдущий кадр
+    // (ячейки и оценка байт, ушедших в терминал) и, если нужно, оверлей профилировщика.
+    // Окно сдвинулось за мячом — границы в статичном слое перерисовываются.
+    void draw(FrameBuffer& frame, bool showProfile) {
+        if (view.follow(state.ball.getX(), state.ball.getY(), state.field_width, state.field_height)) {
+            drawStaticField(frame, state, view);
         }
+        frame.clear();
+        drawGame(frame, state, labels, view);
+        frame.print(view.height, 0, output.get(frame.getCellsEmitted(), frame.getBytesEmitted()));
+        if (showProfile) drawProfileOverlay(frame, view.height + 1);
+    }
+};
 
-        int ch = getch();
+// Партия режима Mode в терминале; цикл собирается под режим при компиляции.
+// saveResults == false — счёт не пишется в журнал (его пишет турнир).
+// Возвращает итоговое состояние: finished == false, если игрок вышел раньше.
+template <class Mode>
+GameState playInTerminal(Config& config, bool saveResults) {
+    // Состояние партии; вся физика живёт в stepAs<Mode>(), здесь только ввод и отрисовка.
+    uint64_t aiSeed = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    matchArena.reset();
+    LocalMatch<Mode> match(config, aiSeed);
+    const GameState& state = match.state;
+    bool isRunning = true;
+    static bool showProfile = false;  // Оверлей профилировщика ('p'), сохраняется между партиями.
+    spectators.beginMatch(config, state);
+
+    // Буфер кадра на окно поля плюс строка статистики вывода и оверлей профилировщика под ним.
+    // Границы поля — статичный слой, на терминал уходят только в первом кадре и при сдвиге окна.
+    match.fitView(config, COLS, LINES - 1);
+    FrameBuffer frame(match.view.width, match.view.height + 1 + PHASE_COUNT);
+    drawStaticField(frame, state, match.view);
+
+    // Перезагрузка настроек: файл проверяется раз в кадр, а скорость, размер поля и высота ракеток
+    // меняются перед ближайшим тиком, чтобы тик не видел поле наполовину старым.
+    bool reloadPending = false;
+    auto reload = [&]() {
+        // Файл с ошибками (например, сохранён посреди правки) не применяется: иначе поля с ошибками
+        // вернулись бы к значениям по умолчанию. Партия идёт дальше со старыми, до следующего сохранения.
+        std::vector<std::string> errors;
+        Config fresh = loadConfig(configPath, configProfile, &errors);
+        if (!errors.empty() || !liveSettingsDiffer(config, fresh)) return;
+        config.speed = fresh.speed;
+        if (fresh.field_width == config.field_width && fresh.field_height == config.field_height &&
+            fresh.paddle_height == config.paddle_height) {
+            return;
+        }
+        config.field_width = fresh.field_width;
+        config.field_height = fresh.field_height;
+        config.paddle_height = fresh.paddle_height;
+        match.resize(config);
+        frame.resize(match.view.width, match.view.height + 1 + PHASE_COUNT);
+        drawStaticField(frame, state, match.view);
+        spectators.beginMatch(config, state);
+    };
+
+    auto tick = [&]() {
+        if (reloadPending) {
+            reloadPending = false;
+            reload();
+        }
+        match.tick();
+        // Проверка на завершение игры
+        if (state.finished) {
+            isRunning = false;
+        }
+    };
+
+    auto key = [&](int ch) {
         switch (ch) {
-            case 'w': player1.moveUp(); break;
-            case 's': player1.moveDown(config.field_height); break;
-            case KEY_UP: player2.moveUp(); break;
-            case KEY_DOWN: player2.moveDown(config.field_height); break;
+            case 'w': match.pending.player1--; break;
+            case 's': match.pending.player1++; break;
+            case KEY_UP: match.pending.player2--; break;
+            case KEY_DOWN: match.pending.player2++; break;
+            case 'p': showProfile = !showProfile; break;
             case 'q': isRunning = false; break;
         }
+    };
 
-        // Логика движения компьютера в режиме игрока против компьютера
-        if (gameMode == 2) {
-            if (ball.getY() < player2.getY()) player2.moveUp();
-            if (ball.getY() > player2.getY() + player2.getHeight()) player2.moveDown(config.field_height);
+    // Отрисовка текущего состояния, вызывается не чаще frame_rate раз в секунду.
+    // На терминал выводятся только изменившиеся ячейки.
+    auto render = [&]() {
+        if (configWatcher.changed()) reloadPending = true;
+        {
+            PROFILE_SCOPE(PHASE_DRAW);
+            match.draw(frame, showProfile);
         }
+        frame.flush();  // Обновление экрана
+    };
 
-        // Логика игры против стены
-        if (gameMode == 3) {
-            if (ball.getX() >= config.field_width - 1) {
-                player1Score++;
-                ball.reset(config.field_width / 2, config.field_height / 2);
-                ball.invertXDirection();
-            }
-            if (ball.checkPaddleCollision(player1)) {
-                ball.invertXDirection();
-            }
-            if (ball.getX() <= 2) {
-                ball.invertXDirection();
-            }
-        }
+    fixedStepLoop(config.speed, config.frame_rate, isRunning, key, tick, render);
+
+    if (match.recording) {
+        match.recorder.finish(state);
+        match.recorder.save(replayPath(config, Mode::id));
+    }
+
+    // Сохранение счёта по завершении игры (против стены не сохраняется)
+    const char* opponent = Mode::opponentName(config);
+    if (saveResults && opponent) {
+        saveScore(config.name_Player1, state.player1Score, opponent, state.player2Score, Mode::id);
+    }
+    return state;
+}
+
+// Одна партия режима Mode на warmup + ticks тиков: сколько раз вызван operator new за последние ticks.
+// Ходы людей случайные; с draw кадр рисуется на каждом тике (в буфер, без терминала).
+template <class Mode>
+uint64_t matchAllocations(const Config& config, long long warmup, long long ticks, bool draw) {
+    Config endless = config;
+    endless.max_score = 1 << 30;
+    matchArena.reset();
+    LocalMatch<Mode> match(endless, 1);
+    FrameBuffer frame(endless.field_width, endless.field_height + 1 + PHASE_COUNT);
+    drawStaticField(frame, match.state);
+    Rng rng(2);
+    uint64_t before = 0;
+    for (long long t = 0; t < warmup + ticks; t++) {
+        if (t == warmup) before = allocationCount();
+        match.pending.player1 = rng.range(3) - 1;
+        match.pending.player2 = rng.range(3) - 1;
+        match.tick();
+        if (draw) match.draw(frame, true);
+    }
+    return allocationCount() - before;
+}
+
+// Установившийся цикл: вторая партия той же длины после первой. Первая доводит арену до размера
+// партии (запись длиннее начального блока берёт новый блок), вторая должна обойтись без operator new.
+template <class Mode>
+uint64_t steadyStateAllocations(const Config& config, long long warmup, long long ticks) {
+    matchAllocations<Mode>(config, warmup, ticks, false);
+    return matchAllocations<Mode>(config, warmup, ticks, true);
+}
 
-        // Проверка на столкновение с ракетками в режиме двух игроков
-        if (ball.checkPaddleCollision(player1) || ball.checkPaddleCollision(player2)) {
-            ball.invertXDirection();
+// Проверка --check-alloc: установившийся цикл партии каждого режима не выделяет память.
+int checkAllocations(const Config& config) {
+    // Тиков столько, чтобы запись повтора вышла за начальный блок арены (1 МБ).
+    const long long warmup = 1000, ticks = 500000;
+    int status = 0;
+    for (int mode : {MODE_VERSUS, MODE_COMPUTER, MODE_WALL}) {
+        uint64_t count = withMode(mode, [&](auto policy) {
+            return steadyStateAllocations<decltype(policy)>(config, warmup, ticks);
+        });
+        printf("mode %d: %llu allocations in %lld ticks after %lld warm-up ticks, arena %zu of %zu bytes%s\n", mode,
+               static_cast<unsigned long long>(count), ticks, warmup, matchArena.getUsed(), matchArena.getCapacity(),
+               count ? "  FAIL" : "");
+        if (count) status = 1;
+    }
+
+    // Пачка сред обучения: шаг пишет только в буферы вызывающего, включая авто-сброс эпизодов.
+    EnvOptions envOptions;
+    envOptions.config = config;
+    envOptions.count = 64;
+    PongEnv env(envOptions);
+    std::vector<float> observations(env.getCount() * ENV_OBS_SIZE), rewards(env.getCount());
+    std::vector<int8_t> actions(env.getCount());
+    std::vector<uint8_t> dones(env.getCount());
+    Rng rng(3);
+    long long episodes = 0, steps = 20000;
+    uint64_t before = 0;
+    env.reset(1, observations.data());
+    for (long long t = 0; t < warmup + steps; t++) {
+        if (t == warmup) before = allocationCount();
+        for (int8_t& action : actions) action = static_cast<int8_t>(rng.range(3)) - 1;
+        env.step(actions.data(), observations.data(), rewards.data(), dones.data());
+        for (uint8_t done : dones) episodes += done;
+    }
+    uint64_t count = allocationCount() - before;
+    printf("env x%d: %llu allocations in %lld steps after %lld warm-up steps, %lld episodes%s\n", env.getCount(),
+           static_cast<unsigned long long>(count), steps, warmup, episodes, count ? "  FAIL" : "");
+    if (count) status = 1;
+    return status;
+}
+
+// Партия в терминале по номеру режима из меню или турнира.
+GameState gameLoop(Config& config, int gameMode, bool saveResults = true) {
+    return withMode(gameMode, [&](auto mode) { return playInTerminal<decltype(mode)>(config, saveResults); });
+}
+
+// Партия турнира с человеком: заставка, затем обычный gameLoop. Человек всегда у левой ракетки,
+// компьютер — у правой с уровнем сложности, ближайшим к типу ИИ. 'q' на заставке
+// или выход из партии до конца ставит турнир на паузу.
+bool tournamentMatch(const Config& config, const TournamentPlayer& player1, const TournamentPlayer& player2,
+                     int& score1, int& score2) {
+    bool swapped = !player1.human;
+    const TournamentPlayer& left = swapped ? player2 : player1;
+    const TournamentPlayer& right = swapped ? player1 : player2;
+    clear();
+    centeredPrint(LINES / 2 - 1, ("Tournament match: " + left.name + " vs " + right.name).c_str(), COLS);
+    centeredPrint(LINES / 2 + 1, "Press any key to start, q to pause the tournament", COLS);
+    refresh();
+    if (getch() == 'q') return false;
+    clear();
+
+    Config matchConfig = config;
+    matchConfig.name_Player1 = left.name;
+    matchConfig.name_Player2 = right.name;
+    if (!right.human) {
+        matchConfig.ai_difficulty = right.ai >= AI_EASY ? right.ai - AI_EASY
+                                  : right.ai == AI_BOT ? DIFFICULTY_EASY : DIFFICULTY_NORMAL;
+    }
+    GameState state = gameLoop(matchConfig, right.human ? MODE_VERSUS : MODE_COMPUTER, false);
+    clear();
+    if (!state.finished) return false;
+    score1 = swapped ? state.player2Score : state.player1Score;
+    score2 = swapped ? state.player1Score : state.player2Score;
+    return true;
+}
+
+// Сетевая партия Player vs Player: свой игрок управляется 'w'/'s' или стрелками,
+// соперник приходит из сети. Физика — та же step(), с предсказанием и откатом в NetSession.
+void netGameLoop(const Config& settings, NetSession& session) {
+    timeout(100);
+    while (!session.isConnected()) {
+        session.poll();
+        clear();
+        centeredPrint(LINES / 2, session.isHost()
+            ? ("Waiting for opponent on UDP port " + std::to_string(session.getLocalPort()) + "... (q to cancel)").c_str()
+            : "Connecting... (q to cancel)", COLS);
+        refresh();
+        if (getch() == 'q') {
+            timeout(-1);
+            return;
         }
+    }
+    timeout(-1);
+    clear();
 
-        // Проверка на выход мяча за границу поля и добавление очков
-        if (ball.outOfBounds(config.field_width) && gameMode != 3) {
-            if (ball.getX() <= 0) player2Score++;
-            if (ball.getX() >= config.field_width - 1) player1Score++;
-            ball.reset(config.field_width / 2, config.field_height / 2);
+    const Config& config = session.getConfig();
+    int pending = 0;  // Накопленный ввод своего игрока, уходит в ближайший тик.
+    bool isRunning = true;
+    static bool showProfile = false;
+
+    auto tick = [&]() {
+        session.poll();
+        // Если тик не сделан (соперник отстал), ввод копится до следующего.
+        if (session.advance(pending)) pending = 0;
+        if (session.finishedConfirmed() || session.hasPeerLeft()) isRunning = false;
+    };
+
+    auto key = [&](int ch) {
+        switch (ch) {
+            case 'w': case KEY_UP: pending--; break;
+            case 's': case KEY_DOWN: pending++; break;
+            case 'p': showProfile = !showProfile; break;
+            case 'q': isRunning = false; break;
         }
+    };
 
-        // Проверка на завершение игры
-        if (player1Score >= config.max_score || player2Score >= config.max_score) {
-            isRunning = false;
+    // Окно на поле под терминал, как в локальной партии: поле хоста может быть больше нашего экрана.
+    Viewport view = Viewport::fit(config.field_width, config.field_height, COLS, LINES - 1);
+    FrameBuffer frame(view.width, view.height + 1 + PHASE_COUNT);
+    drawStaticField(frame, session.getState(), view);
+    MatchLabels labels;
+    labels.setPlayers(config.name_Player1, config.name_Player2.c_str(), view.width);
+
+    auto render = [&]() {
+        session.poll();
+        {
+            PROFILE_SCOPE(PHASE_DRAW);
+            char text[128];
+            const NetStats& stats = session.getStats();
+            const GameState& state = session.getState();
+            if (view.follow(state.ball.getX(), state.ball.getY(), state.field_width, state.field_height)) {
+                drawStaticField(frame, state, view);
+            }
+            frame.clear();
+            drawGame(frame, state, labels, view);
+            snprintf(text, sizeof(text), "Net: rtt %d ms, delay %d, rollbacks %lld (max %lld ticks), stalls %lld",
+                     stats.rttMs, session.getInputDelay(), stats.rollbacks, stats.maxRollback, stats.stalls);
+            frame.print(view.height, 0, text);
+            if (showProfile) drawProfileOverlay(frame, view.height + 1);
         }
+        frame.flush();
+    };
+
+    fixedStepLoop(config.speed, settings.frame_rate, isRunning, key, tick, render);
 
-        refresh();  // Обновление экрана
+    if (session.hasPeerLeft() || !session.getState().finished) {
+        session.leave();
+        return;
     }
-    
-    // Сохранение счёта по завершении игры
-    if (gameMode == 1) {
-        saveScore(config.name_Player1, player1Score, config.name_Player2, player2Score);
+    // Соперник должен получить наш ввод до последнего тика, иначе он не подтвердит конец партии.
+    auto linger = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (!session.allAcknowledged() && std::chrono::steady_clock::now() < linger) {
+        session.poll();
+        napms(5);
+    }
+    // Счёт сохраняет только хост, чтобы партия на одной машине не записалась дважды.
+    if (session.isHost()) {
+        const GameState& state = session.getState();
+        saveScore(config.name_Player1, state.player1Score, config.name_Player2, state.player2Score, MODE_VERSUS);
+    }
+}
+
+// Просмотр чужой партии (--spectate): кадры приходят от сервера трансляции,
+// рисуются через тот же drawGame(), что и в gameLoop. 'q' — выход.
+void spectateLoop(const SpectateAddress& address, const Config& settings) {
+    SpectatorClient client;
+    if (!client.connect(address)) {
+        clear();
+        centeredPrint(LINES / 2, "Unable to connect to the broadcast. Press any key.", COLS);
+        getch();
+        return;
     }
-    if (gameMode == 2) {
-        saveScore(config.name_Player1, player1Score, "Computer", player2Score);
+
+    FrameBuffer frame(0, 0);
+    Viewport view;
+    MatchLabels labels;
+    bool connected = true;
+    timeout(1000 / std::max(settings.frame_rate, 1));
+    for (;;) {
+        int ch = getch();
+        if (ch == 'q') break;
+        if (connected && !client.receive()) connected = false;
+        if (!client.hasState()) {
+            centeredPrint(LINES / 2, connected ? "Waiting for a match..." : "Broadcast ended. Press q.", COLS);
+            refresh();
+            continue;
+        }
+
+        const Config& config = client.getConfig();
+        const GameState& state = client.getState();
+        if (client.takeFieldChanged()) {
+            // Ключевой кадр: новая партия, поле и имена могли смениться. Окно подгоняется под терминал заново.
+            view = Viewport::fit(state.field_width, state.field_height, COLS, LINES - 1);
+            frame.resize(view.width, view.height + 1);
+            drawStaticField(frame, state, view);
+            labels.setPlayers(config.name_Player1, opponentName(state.mode, config), view.width);
+        }
+        if (view.follow(state.ball.getX(), state.ball.getY(), state.field_width, state.field_height)) {
+            drawStaticField(frame, state, view);
+        }
+        char text[96];
+        frame.clear();
+        drawGame(frame, state, labels, view);
+        snprintf(text, sizeof(text), "Spectating: tick %lld, %lld frames%s", state.tick,
+                 client.getFrames(), connected ? "" : " (broadcast ended, q to quit)");
+        frame.print(view.height, 0, text);
+        frame.flush();
     }
+    timeout(-1);
+}
+
+// Просмотр повтора на экране через тот же путь отрисовки, что и игра.
+// Пробел — пауза, стрелки влево/вправо — перемотка на ключевой кадр, 'p' — профилировщик, 'q' — выход.
+void replayLoop(ReplayPlayer& player, const Config& settings) {
+    const Config& config = player.getConfig();
+    bool isRunning = true;
+    bool paused = false;
+    bool showProfile = false;
+
+    // Окно на поле под терминал; fieldWidth/fieldHeight — поле, под которое оно подогнано.
+    int fieldWidth = player.getState().field_width, fieldHeight = player.getState().field_height;
+    Viewport view = Viewport::fit(fieldWidth, fieldHeight, COLS, LINES - 1);
+    FrameBuffer frame(view.width, view.height + 1 + PHASE_COUNT);
+    drawStaticField(frame, player.getState(), view);
+    MatchLabels labels;
+    labels.setPlayers(config.name_Player1, opponentName(player.getState().mode, config), view.width);
+
+    auto key = [&](int ch) {
+        long long tick = player.getState().tick;
+        switch (ch) {
+            case ' ': paused = !paused; break;
+            case KEY_LEFT: player.seek(tick - REPLAY_KEYFRAME_INTERVAL); break;
+            case KEY_RIGHT: player.seek(tick + REPLAY_KEYFRAME_INTERVAL); break;
+            case 'p': showProfile = !showProfile; break;
+            case 'q': isRunning = false; break;
+        }
+    };
+    auto tick = [&]() {
+        if (!paused && !player.done()) player.stepTick();
+    };
+    auto render = [&]() {
+        {
+            PROFILE_SCOPE(PHASE_DRAW);
+            const GameState& state = player.getState();
+            // Поле меняется, если в партии перезагружались настройки (и при перемотке через такую смену).
+            if (state.field_width != fieldWidth || state.field_height != fieldHeight) {
+                fieldWidth = state.field_width;
+                fieldHeight = state.field_height;
+                view = Viewport::fit(fieldWidth, fieldHeight, COLS, LINES - 1);
+                frame.resize(view.width, view.height + 1 + PHASE_COUNT);
+                drawStaticField(frame, state, view);
+                labels.setPlayers(config.name_Player1, opponentName(state.mode, config), view.width);
+            }
+            if (view.follow(state.ball.getX(), state.ball.getY(), state.field_width, state.field_height)) {
+                drawStaticField(frame, state, view);
+            }
+            char text[96];
+            frame.clear();
+            drawGame(frame, state, labels, view);
+            snprintf(text, sizeof(text), "Replay: tick %lld / %lld%s", state.tick, player.getTotalTicks(),
+                     player.done() ? " (end)" : paused ? " (paused)" : "");
+            frame.print(view.height, 0, text);
+            if (showProfile) drawProfileOverlay(frame, view.height + 1);
+        }
+        frame.flush();
+    };
+
+    fixedStepLoop(config.speed, settings.frame_rate, isRunning, key, tick, render);
 }
 
+// Арена на много мячей в терминале (--multiball N): левая ракетка — игрок ('w'/'s'), правая — компьютер.
+// Поле может быть больше терминала: окно следует за ракеткой игрока, стрелки сдвигают его
+// вручную, 'f' возвращает слежение. Арена идёт до 'q'.
+void multiBallLoop(const Config& config, int ballCount) {
+    uint64_t seed = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    MultiBallGame game = newMultiBallGame(config, ballCount, seed);
+    bool isRunning = true;
+    bool follow = true;
+    bool moved = false;
+    Inputs pending;
+
+    Viewport view = Viewport::fit(config.field_width, config.field_height, COLS, LINES - 2);
+    FrameBuffer frame(view.width, view.height + 2);
+    drawFieldBorders(frame, game.field_width, game.field_height, false, view);
+    CachedText score("Score: %lld | %lld");
+    CachedText status("Balls: %lld, collisions: %lld");
+
+    auto key = [&](int ch) {
+        int stepX = std::max(view.width / 4, 1), stepY = std::max(view.height / 4, 1);
+        switch (ch) {
+            case 'w': pending.player1--; break;
+            case 's': pending.player1++; break;
+            case KEY_LEFT: follow = false; moved |= view.pan(-stepX, 0, game.field_width, game.field_height); break;
+            case KEY_RIGHT: follow = false; moved |= view.pan(stepX, 0, game.field_width, game.field_height); break;
+            case KEY_UP: follow = false; moved |= view.pan(0, -stepY, game.field_width, game.field_height); break;
+            case KEY_DOWN: follow = false; moved |= view.pan(0, stepY, game.field_width, game.field_height); break;
+            case 'f': follow = true; break;
+            case 'q': isRunning = false; break;
+        }
+    };
+    auto tick = [&]() {
+        pending.player2 += multiBallComputerMove(game, game.player2);
+        stepMultiBall(game, pending);
+        pending = Inputs();
+    };
+    auto render = [&]() {
+        {
+            PROFILE_SCOPE(PHASE_DRAW);
+            const Paddle& paddle = game.player1;
+            if (follow) {
+                moved |= view.follow(paddle.getX(), paddle.getY() + paddle.getHeight() / 2, game.field_width,
+                                     game.field_height);
+            }
+            if (moved) drawFieldBorders(frame, game.field_width, game.field_height, false, view);
+            moved = false;
+            frame.clear();
+            drawMultiBall(frame, game, view);
+            frame.print(view.height, 0, score.get(game.player1Score, game.player2Score));
+            frame.print(view.height + 1, 0, status.get(static_cast<long long>(game.balls.size()), game.collisions));
+        }
+        frame.flush();
+    };
+
+    fixedStepLoop(config.speed, config.frame_rate, isRunning, key, tick, render);
+}
+
+// Повтор без терминала на максимальной скорости со сверкой итога.
+int replayHeadless(ReplayPlayer& player) {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    bool matches = player.runToEnd();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    const GameState& state = player.getState();
+    printf("ticks:      %lld\n", state.tick);
+    printf("score:      %d | %d\n", state.player1Score, state.player2Score);
+    printf("time:       %.6f s\n", seconds);
+    printf("ticks/sec:  %.0f\n", seconds > 0 ? state.tick / seconds : 0.0);
+    printf("result:     %s\n", matches ? "matches recording" : "MISMATCH");
+    return matches ? 0 : 1;
+}
+
+// Соперник агента в --env-server и --bench-env: сложность ComputerAI или self — второй агент.
+static bool parseEnvOpponent(const std::string& name, EnvOptions& options) {
+    options.selfPlay = name == "self";
+    return options.selfPlay || parseDifficulty(name, options.opponent);
+}
+
+// Числа в ключах: значение целиком, без хвоста вроде "12abc", иначе std::invalid_argument
+// или std::out_of_range (их ловит разбор ключей в main).
+static long long longArg(const char* text) {
+    char* end = nullptr;
+    errno = 0;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || *end != '\0') throw std::invalid_argument(text);
+    if (errno == ERANGE) throw std::out_of_range(text);
+    return value;
+}
+
+static int intArg(const char* text) {
+    long long value = longArg(text);
+    if (value < INT_MIN || value > INT_MAX) throw std::out_of_range(text);
+    return static_cast<int>(value);
+}
+
+static uint64_t seedArg(const char* text) {
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || text[0] == '-') throw std::invalid_argument(text);
+    if (errno == ERANGE) throw std::out_of_range(text);
+    return value;
+}
+
+// Справка по ключам — при неизвестном ключе или значении, которое не читается как число.
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--profile NAME] [--bench-config [N]] [--fuzz-config [N] [--seed S]]"
+              << " [--headless [--matches N] [--seed S] [--max-ticks T] [--threads N] [--scaling]"
+              << " [--player1-ai AI] [--player2-ai AI] [--mode versus|computer|wall]]"
+              << " [--bench-modes [--matches N] [--max-ticks T]] [--check-alloc]"
+              << " [--multiball N] [--bench-multiball [--seed S]]"
+              << " [--env-server NAME | --bench-env [N] [--seed S]] [--envs N] [--opponent DIFFICULTY|self]"
+              << " [--max-ticks T]"
+              << " [--bench-batch [--games K] [--ticks T]] [--fuzz-physics [N] [--seed S] [--threads N]]"
+              << " [--rebuild-stats] [--bench-stats [N]]"
+              << " [--replay FILE [--headless]] [--replay-check FILE...] [--profile-out FILE.csv|FILE.json]"
+              << " [--host PORT | --join HOST:PORT | --net-selftest [--ticks T]]"
+              << " [--net-delay TICKS] [--net-latency MS] [--net-jitter MS] [--net-loss PCT]"
+              << " [--broadcast PORT|SOCKET] [--spectate HOST:PORT|SOCKET] [--spectate-loadtest [N] [--ticks T]]"
+              << " [--tournament PLAYERS [--format rr|se] [--resume] [--threads N] [--seed S] [--max-ticks T]]"
+              << std::endl;
+}
 
 // Основная функция, инициализирующая ncurses и запускающая главное меню.
-int main() {
+// С ключом --headless вместо меню запускается серия партий без терминала.
+int main(int argc, char* argv[]) {
+    bool headless = false;
+    HeadlessOptions headlessOptions;
+    bool benchBatch = false;
+    bool benchModes = false;
+    bool benchMultiBall = false;
+    int multiBall = 0;
+    bool checkAlloc = false;
+    bool rebuildStats = false;
+    long long benchStats = 0;
+    std::string replayFile;
+    std::vector<std::string> replayChecks;
+    std::string profileOut;
+    int batchGames = 4096, ticks = 0;
+    int hostPort = -1;
+    std::string joinAddress;
+    bool netSelfTest = false;
+    int netDelay = 2;
+    LinkConditions link;
+    std::string broadcastAddress, spectateAddress;
+    int spectateLoadTest = 0;
+    long long fuzzPhysics = 0;
+    long long benchConfig = 0, fuzzConfig = 0;
+    TournamentOptions tournament;
+    std::string envServer;
+    long long benchEnv = 0;
+    EnvOptions envOptions;
+    envOptions.count = 0;
+    // Нечисловое или слишком большое значение ключа — исключение из intArg/longArg/seedArg,
+    // после которого печатается справка, как для неизвестного ключа.
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--headless") headless = true;
+            else if (arg == "--matches" && i + 1 < argc) headlessOptions.matches = intArg(argv[++i]);
+            else if (arg == "--seed" && i + 1 < argc) headlessOptions.seed = seedArg(argv[++i]);
+            else if (arg == "--max-ticks" && i + 1 < argc) headlessOptions.maxTicks = longArg(argv[++i]);
+            else if (arg == "--threads" && i + 1 < argc) headlessOptions.threads = intArg(argv[++i]);
+            else if (arg == "--scaling") headlessOptions.scaling = true;
+            else if (arg == "--player1-ai" && i + 1 < argc && parseAiType(argv[i + 1], headlessOptions.player1)) i++;
+            else if (arg == "--player2-ai" && i + 1 < argc && parseAiType(argv[i + 1], headlessOptions.player2)) i++;
+            else if (arg == "--mode" && i + 1 < argc && parseModeName(argv[i + 1], headlessOptions.mode)) i++;
+            else if (arg == "--bench-batch") benchBatch = true;
+            else if (arg == "--bench-modes") benchModes = true;
+            else if (arg == "--bench-multiball") benchMultiBall = true;
+            else if (arg == "--multiball" && i + 1 < argc) multiBall = intArg(argv[++i]);
+            else if (arg == "--check-alloc") checkAlloc = true;
+            else if (arg == "--env-server" && i + 1 < argc) envServer = argv[++i];
+            else if (arg == "--bench-env") benchEnv = (i + 1 < argc && argv[i + 1][0] != '-') ? longArg(argv[++i]) : 100000000;
+            else if (arg == "--envs" && i + 1 < argc) envOptions.count = intArg(argv[++i]);
+            else if (arg == "--opponent" && i + 1 < argc && parseEnvOpponent(argv[i + 1], envOptions)) i++;
+            else if (arg == "--rebuild-stats") rebuildStats = true;
+            else if (arg == "--replay" && i + 1 < argc) replayFile = argv[++i];
+            else if (arg == "--profile-out" && i + 1 < argc) profileOut = argv[++i];
+            else if (arg == "--replay-check") {
+                while (i + 1 < argc && argv[i + 1][0] != '-') replayChecks.push_back(argv[++i]);
+            }
+            else if (arg == "--fuzz-physics") fuzzPhysics = (i + 1 < argc && argv[i + 1][0] != '-') ? longArg(argv[++i]) : 100000000;
+            else if (arg == "--profile" && i + 1 < argc) configProfile = argv[++i];
+            else if (arg == "--bench-config") benchConfig = (i + 1 < argc && argv[i + 1][0] != '-') ? longArg(argv[++i]) : 1000000;
+            else if (arg == "--fuzz-config") fuzzConfig = (i + 1 < argc && argv[i + 1][0] != '-') ? longArg(argv[++i]) : 1000000;
+            else if (arg == "--bench-stats") benchStats = (i + 1 < argc && argv[i + 1][0] != '-') ? longArg(argv[++i]) : 10000000;
+            else if (arg == "--games" && i + 1 < argc) batchGames = intArg(argv[++i]);
+            else if (arg == "--ticks" && i + 1 < argc) ticks = intArg(argv[++i]);
+            else if (arg == "--host" && i + 1 < argc) hostPort = intArg(argv[++i]);
+            else if (arg == "--join" && i + 1 < argc) joinAddress = argv[++i];
+            else if (arg == "--net-selftest") netSelfTest = true;
+            else if (arg == "--tournament" && i + 1 < argc) tournament.playersPath = argv[++i];
+            else if (arg == "--format" && i + 1 < argc && parseTournamentFormat(argv[i + 1], tournament.format)) i++;
+            else if (arg == "--resume") tournament.resume = true;
+            else if (arg == "--broadcast" && i + 1 < argc) broadcastAddress = argv[++i];
+            else if (arg == "--spectate" && i + 1 < argc) spectateAddress = argv[++i];
+            else if (arg == "--spectate-loadtest") spectateLoadTest = (i + 1 < argc && argv[i + 1][0] != '-') ? intArg(argv[++i]) : 1000;
+            else if (arg == "--net-delay" && i + 1 < argc) netDelay = intArg(argv[++i]);
+            else if (arg == "--net-latency" && i + 1 < argc) link.latencyMs = intArg(argv[++i]);
+            else if (arg == "--net-jitter" && i + 1 < argc) link.jitterMs = intArg(argv[++i]);
+            else if (arg == "--net-loss" && i + 1 < argc) link.lossPercent = intArg(argv[++i]);
+            else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::logic_error&) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (benchConfig > 0) {
+        return runConfigBenchmark(configPath, benchConfig);
+    }
+    if (fuzzConfig > 0) {
+        return runConfigFuzz(fuzzConfig, headlessOptions.seed);
+    }
+    // Настройки читаются после разбора ключей: профиль задаётся в командной строке.
+    // Ошибки в файле не мешают игре — значения с ошибками остаются по умолчанию.
+    ConfigFile configFile;
+    readConfigFile(configPath, configFile);
+    std::vector<std::string> configErrors = configFile.errors;
+    Config config;
+    bool profileFound = resolveConfig(configFile, configProfile, config, configErrors);
+    for (const std::string& error : configErrors) std::cerr << configPath << ": " << error << std::endl;
+    if (!profileFound) return 1;
+
+    ReplayPlayer replay;
+    if (!replayFile.empty() && !replay.load(replayFile)) {
+        std::cerr << "Error: Unable to read replay " << replayFile << std::endl;
+        return 1;
+    }
+    if (!replayFile.empty() && headless) {
+        return replayHeadless(replay);
+    }
+    if (!replayChecks.empty()) {
+        return checkReplays(replayChecks, headlessOptions.threads > 0 ? headlessOptions.threads : defaultThreadCount());
+    }
+    if (headless) {
+        return runHeadless(config, headlessOptions);
+    }
+    if (checkAlloc) {
+        return checkAllocations(config);
+    }
+    if (!envServer.empty() || benchEnv > 0) {
+        envOptions.config = config;
+        envOptions.maxTicks = headlessOptions.maxTicks;
+        if (!envServer.empty()) {
+            if (envOptions.count < 1) envOptions.count = 1;
+            return serveEnv(envServer, envOptions);
+        }
+        if (envOptions.count < 1) envOptions.count = 256;
+        return runEnvBenchmark(envOptions, benchEnv, headlessOptions.seed);
+    }
+    if (benchMultiBall) {
+        return runMultiBallBenchmark(config, headlessOptions.seed);
+    }
+    if (benchModes) {
+        return runModeBenchmark(config, headlessOptions);
+    }
+    if (benchBatch) {
+        return runBatchBenchmark(config, batchGames, ticks > 0 ? ticks : 2000);
+    }
+    if (fuzzPhysics > 0) {
+        return runPhysicsFuzz(fuzzPhysics, headlessOptions.seed, headlessOptions.threads);
+    }
+    if (rebuildStats) {
+        return rebuildLeaderboard();
+    }
+    if (benchStats > 0) {
+        return runStatsBenchmark(benchStats);
+    }
+    if (netSelfTest) {
+        return runNetSelfTest(config, link, netDelay, ticks > 0 ? ticks : 600, 60);
+    }
+    if (spectateLoadTest > 0) {
+        return runSpectateLoadTest(config, spectateLoadTest, ticks > 0 ? ticks : 120, 60);
+    }
+    // Турнир только из ИИ играется без терминала; с людьми — ниже, после инициализации ncurses.
+    std::vector<TournamentPlayer> tournamentPlayers;
+    std::string tournamentReport;
+    int tournamentResult = 0;
+    if (!tournament.playersPath.empty()) {
+        tournament.threads = headlessOptions.threads;
+        tournament.seed = headlessOptions.seed;
+        tournament.maxTicks = headlessOptions.maxTicks;
+        std::string error;
+        if (!loadTournamentPlayers(tournament.playersPath, tournamentPlayers, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        if (!tournamentHasHumans(tournamentPlayers)) {
+            tournamentResult = runTournament(config, tournament, HumanMatchFn(), tournamentReport);
+            fputs(tournamentReport.c_str(), stdout);
+            return tournamentResult;
+        }
+    }
+    SpectateAddress broadcast, spectate;
+    if ((!broadcastAddress.empty() && !parseSpectateAddress(broadcastAddress, broadcast)) ||
+        (!spectateAddress.empty() && !parseSpectateAddress(spectateAddress, spectate))) {
+        std::cerr << "Error: Bad address " << broadcastAddress << spectateAddress << std::endl;
+        return 1;
+    }
+    if (!broadcastAddress.empty() && !spectators.start(broadcast)) {
+        std::cerr << "Error: Unable to start broadcast on " << broadcastAddress << std::endl;
+        return 1;
+    }
+    NetSession session;
+    if (hostPort >= 0 || !joinAddress.empty()) {
+        bool opened = hostPort >= 0 ? session.listen(hostPort, config, netDelay) : session.join(joinAddress, config);
+        if (!opened) {
+            std::cerr << "Error: Unable to open network session" << std::endl;
+            return 1;
+        }
+        session.setLinkConditions(link);
+    }
+
+    configWatcher.watch(configPath);
+
     initscr(); // инициализация
     noecho(); // Символы минус
     curs_set(FALSE); // Курсор минус
     keypad(stdscr, TRUE); // Поддержка функциональных клавиш
 
-    Config config = loadConfig("config.ini");
-
     bool isRunning = true;
+    if (!replayFile.empty()) {
+        replayLoop(replay, config);
+        isRunning = false;
+    }
+    if (hostPort >= 0 || !joinAddress.empty()) {
+        netGameLoop(config, session);
+        isRunning = false;
+    }
+    if (multiBall > 0) {
+        multiBallLoop(config, multiBall);
+        isRunning = false;
+    }
+    if (!spectateAddress.empty()) {
+        spectateLoop(spectate, config);
+        isRunning = false;
+    }
+    if (!tournament.playersPath.empty()) {
+        auto human = [&](const TournamentPlayer& player1, const TournamentPlayer& player2, int& score1, int& score2) {
+            return tournamentMatch(config, player1, player2, score1, score2);
+        };
+        tournamentResult = runTournament(config, tournament, human, tournamentReport);
+        isRunning = false;
+    }
+
     while (isRunning) {
         int choice = showMenu();
         switch (choice) {
@@ -484,13 +1296,37 @@ int main() {
                 showResults();
                 break;
             case 4:
-                settingsMenu(config);
+                showLeaderboard();
                 break;
             case 5:
+                settingsMenu(config);
+                break;
+            case 6:
                 isRunning = false;
                 break;
         }
     }
     endwin();
+    spectators.stop();
+    saveLeaderboard();
+    if (!tournament.playersPath.empty()) {
+        fputs(tournamentReport.c_str(), stdout);
+        return tournamentResult;
+    }
+
+    if (session.isConnected()) {
+        const NetStats& stats = session.getStats();
+        printf("Network: %lld ticks, rollbacks %lld, resimulated %lld ticks (max %lld), resim %.0f ns/tick, "
+               "stalls %lld, rtt %d ms, input delay %d\n",
+               session.getTick(), stats.rollbacks, stats.resimulatedTicks, stats.maxRollback,
+               stats.resimulatedTicks ? stats.resimulationNs / stats.resimulatedTicks : 0.0, stats.stalls,
+               stats.rttMs, session.getInputDelay());
+    }
+
+    // Дамп профилировщика по всем сыгранным партиям.
+    if (!profileOut.empty() && !profiler.write(profileOut)) {
+        std::cerr << "Error: Unable to write " << profileOut << std::endl;
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file
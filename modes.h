@@ -0,0 +1,68 @@
+#ifndef PONG_MODES_H
+#define PONG_MODES_H
+
+// Режимы игры как типы-политики. Политика описывает только то, чем режим отличается от других:
+// правила тика (стена, счёт), ход компьютера и кто играет справа. Тик stepAs<Mode>(), партия
+// в терминале и партия без терминала собираются из политики при компиляции, поэтому внутри
+// тика нет проверок номера режима. Номер режима приходит только извне (меню, повтор, сеть)
+// и переводится в тип один раз на партию через withMode().
+// Новый режим — ещё одна политика с теми же членами и строка в withMode().
+
+#include "ai.h"
+#include "game.h"
+
+// Игрок против игрока.
+struct Versus {
+    static const int id = MODE_VERSUS;
+    static void returnBall(GameState&) {}
+    static void score(GameState& state) { scoreOutOfBounds(state); }
+    static int computerMove(ComputerAI&, const GameState&) { return 0; }
+    // Имя правого игрока на экране и в журнале; nullptr — справа никого нет.
+    static const char* opponentName(const Config& config) { return config.name_Player2.c_str(); }
+};
+
+// Игрок против компьютера: правой ракеткой управляет ComputerAI.
+struct VsComputer {
+    static const int id = MODE_COMPUTER;
+    static void returnBall(GameState&) {}
+    static void score(GameState& state) { scoreOutOfBounds(state); }
+    static int computerMove(ComputerAI& computer, const GameState& state) { return computer.move(state, state.player2); }
+    static const char* opponentName(const Config&) { return "Computer"; }
+};
+
+// Игрок против стены: слева стена, промахи считаются очками player1, в журнал не пишется.
+struct VsWall {
+    static const int id = MODE_WALL;
+    static void returnBall(GameState& state) { returnFromWall(state); }
+    static void score(GameState& state) { scoreWallMiss(state); }
+    static int computerMove(ComputerAI&, const GameState&) { return 0; }
+    static const char* opponentName(const Config&) { return nullptr; }
+};
+
+// Тик режима Mode; результат совпадает с step() для state.mode == Mode::id.
+template <class Mode>
+inline void stepAs(GameState& state, const Inputs& inputs) {
+    moveBall(state);
+    movePaddles(state, inputs);
+    Mode::returnBall(state);
+    hitPaddles(state);
+    Mode::score(state);
+    finishTick(state);
+}
+
+// Вызов fn(Mode()) с политикой для номера режима; неизвестный номер — игрок против игрока.
+template <class Fn>
+auto withMode(int mode, Fn&& fn) -> decltype(fn(Versus())) {
+    switch (mode) {
+        case MODE_COMPUTER: return fn(VsComputer());
+        case MODE_WALL: return fn(VsWall());
+        default: return fn(Versus());
+    }
+}
+
+// Имя правого игрока для режима, известного только во время выполнения (повторы, зрители, сеть).
+inline const char* opponentName(int mode, const Config& config) {
+    return withMode(mode, [&](auto policy) { return decltype(policy)::opponentName(config); });
+}
+
+#endif
@@ -0,0 +1,232 @@
+#include "multiball.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+BallGrid::BallGrid() : shift(BALL_SHIFT + 1), columns(1), rows(1), cellStart(2, 0) {}
+
+void BallGrid::resize(int field_width, int field_height, int ballCount) {
+    int width = std::max(field_width, 1), height = std::max(field_height, 1);
+    long long limit = 4LL * std::max(ballCount, 1);
+    int size = 1;  // log2 размера ячейки в клетках; не меньше двух клеток.
+    for (;;) {
+        columns = ((width - 1) >> size) + 1;
+        rows = ((height - 1) >> size) + 1;
+        if (static_cast<long long>(columns) * rows <= limit || (columns == 1 && rows == 1)) break;
+        size++;
+    }
+    shift = BALL_SHIFT + size;
+    cellStart.assign(columns * rows + 1, 0);
+    order.assign(ballCount, 0);
+    cellOf.assign(ballCount, 0);
+    sortedX.assign(ballCount, 0);
+    sortedY.assign(ballCount, 0);
+}
+
+void BallGrid::build(const std::vector<Ball>& balls) {
+    // Сортировка подсчётом: размеры ячеек, концы ячеек, затем раскладка с конца.
+    int cells = columns * rows;
+    int count = static_cast<int>(balls.size());
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+    for (int i = 0; i < count; i++) {
+        int cell = row(balls[i].getFixedY()) * columns + column(balls[i].getFixedX());
+        cellOf[i] = cell;
+        cellStart[cell]++;
+    }
+    int end = 0;
+    for (int cell = 0; cell < cells; cell++) {
+        end += cellStart[cell];
+        cellStart[cell] = end;
+    }
+    cellStart[cells] = count;
+    for (int i = count - 1; i >= 0; i--) {
+        int k = --cellStart[cellOf[i]];
+        order[k] = i;
+        sortedX[k] = balls[i].getFixedX();
+        sortedY[k] = balls[i].getFixedY();
+    }
+}
+
+MultiBallGame newMultiBallGame(const Config& config, int ballCount, uint64_t seed) {
+    GameState single = newGame(config, MODE_VERSUS);
+    MultiBallGame game{
+        config.field_width,
+        config.field_height,
+        single.player1,
+        single.player2,
+        std::vector<Ball>(),
+        single.physics,
+        0,
+        0,
+        0,
+        0,
+        Rng(seed),
+        BallGrid()
+    };
+
+    // Мячи в случайных клетках между ракетками, по горизонтали со скоростью подачи,
+    // по вертикали — случайная доля от неё в любую сторону.
+    int speed = game.physics.speed;
+    int left = 3 * BALL_ONE, right = (config.field_width - 4) * BALL_ONE;
+    int top = BALL_ONE, bottom = (config.field_height - 2) * BALL_ONE;
+    game.balls.reserve(ballCount);
+    for (int i = 0; i < ballCount; i++) {
+        Ball ball(0, 0);
+        ball.setFixedX(left + game.rng.range(std::max(right - left, 1)));
+        ball.setFixedY(top + game.rng.range(std::max(bottom - top, 1)));
+        ball.setDX(game.rng.range(2) ? speed : -speed);
+        ball.setDY(game.rng.range(2 * speed + 1) - speed);
+        game.balls.push_back(ball);
+    }
+    game.grid.resize(config.field_width, config.field_height, ballCount);
+    game.grid.build(game.balls);
+    return game;
+}
+
+// Упругий удар равных масс: мячи, которые сближаются, обмениваются скоростями.
+// Разлетающиеся не трогаются, иначе пара, не успевшая разойтись за тик, слиплась бы.
+static bool collide(Ball& a, Ball& b) {
+    long long rx = b.getFixedX() - a.getFixedX(), ry = b.getFixedY() - a.getFixedY();
+    long long vx = b.getDX() - a.getDX(), vy = b.getDY() - a.getDY();
+    if (rx * vx + ry * vy >= 0) return false;
+    int dx = a.getDX(), dy = a.getDY();
+    a.setDX(b.getDX());
+    a.setDY(b.getDY());
+    b.setDX(dx);
+    b.setDY(dy);
+    return true;
+}
+
+void stepMultiBall(MultiBallGame& game, const Inputs& inputs) {
+    // Тот же порядок, что у step(): мячи, ракетки, удары, очки.
+    for (Ball& ball : game.balls) {
+        ball.move();
+        ball.bounce(game.field_height);
+    }
+    movePaddle(game.player1, inputs.player1, game.field_height);
+    movePaddle(game.player2, inputs.player2, game.field_height);
+
+    for (Ball& ball : game.balls) {
+        if (ball.checkPaddleCollision(game.player1, game.field_height)) {
+            ball.bounceOffPaddle(game.player1, game.field_height, game.physics);
+        } else if (ball.checkPaddleCollision(game.player2, game.field_height)) {
+            ball.bounceOffPaddle(game.player2, game.field_height, game.physics);
+        }
+        if (!ball.outOfBounds(game.field_width)) continue;
+        // Очко за этот мяч; он подаётся из центра со случайной строки, остальные летят дальше.
+        if (ball.getFixedX() <= 0) game.player2Score++;
+        else game.player1Score++;
+        ball.reset(game.field_width / 2, 1 + game.rng.range(std::max(game.field_height - 2, 1)), game.physics.speed);
+    }
+
+    game.grid.build(game.balls);
+    std::vector<Ball>& balls = game.balls;
+    long long collisions = 0;  // Счётчик в локальной переменной: запись в game мешала бы держать сетку в регистрах.
+    game.grid.forEachClosePair([&](int a, int b) {
+        if (collide(balls[a], balls[b])) collisions++;
+    });
+    game.collisions += collisions;
+    game.tick++;
+}
+
+int multiBallComputerMove(const MultiBallGame& game, const Paddle& paddle) {
+    // Ближайший по времени мяч, летящий к ракетке: время — путь до колонки, делённый на скорость;
+    // дроби сравниваются перекрёстным умножением.
+    int plane = paddle.getX() * BALL_ONE;
+    bool toLeft = paddle.getX() < game.field_width / 2;
+    long long bestPath = -1, bestSpeed = 1;
+    int target = -1;
+    for (const Ball& ball : game.balls) {
+        int dx = ball.getDX();
+        if (toLeft ? dx >= 0 : dx <= 0) continue;
+        long long path = toLeft ? ball.getFixedX() - plane : plane - ball.getFixedX();
+        long long speed = dx < 0 ? -dx : dx;
+        if (path < 0) continue;
+        if (bestPath < 0 || path * bestSpeed < bestPath * speed) {
+            bestPath = path;
+            bestSpeed = speed;
+            target = ball.getY();
+        }
+    }
+    if (target < 0) return 0;
+    if (target < paddle.getY()) return -1;
+    if (target >= paddle.getY() + paddle.getHeight()) return 1;
+    return 0;
+}
+
+// Полный перебор пар — эталон для сверки с сеткой и точка отсчёта по времени.
+static long long countClosePairsBrute(const std::vector<Ball>& balls) {
+    long long pairs = 0;
+    size_t count = balls.size();
+    for (size_t a = 0; a < count; a++) {
+        for (size_t b = a + 1; b < count; b++) {
+            if (BallGrid::close(balls[a], balls[b])) pairs++;
+        }
+    }
+    return pairs;
+}
+
+int runMultiBallBenchmark(const Config& config, uint64_t seed) {
+    using Clock = std::chrono::steady_clock;
+    static const int FIELDS[][2] = {{100, 30}, {400, 120}, {1000, 1000}};
+    static const int BALLS[] = {1, 10, 100, 1000, 10000, 100000};
+    const double MIN_SECONDS = 0.2;
+    int status = 0;
+
+    printf("%-10s %7s %6s %9s %11s %11s %12s %12s  %s\n", "field", "balls", "cell", "ticks", "ns/tick",
+           "ns/ball", "coll/tick", "brute ns", "pairs");
+    for (const int* field : FIELDS) {
+        Config arena = config;
+        arena.field_width = field[0];
+        arena.field_height = field[1];
+        arena.paddle_height = std::min(config.paddle_height, field[1] - 3);
+        for (int ballCount : BALLS) {
+            MultiBallGame game = newMultiBallGame(arena, ballCount, seed);
+            // Разгон: мячи расходятся со стартовых мест, столкновения выходят на обычный уровень.
+            for (int t = 0; t < 50; t++) {
+                Inputs inputs;
+                inputs.player1 = multiBallComputerMove(game, game.player1);
+                inputs.player2 = multiBallComputerMove(game, game.player2);
+                stepMultiBall(game, inputs);
+            }
+
+            long long ticks = 0, collisionsBefore = game.collisions;
+            Clock::time_point start = Clock::now();
+            double seconds = 0;
+            while (seconds < MIN_SECONDS || ticks < 10) {
+                for (int t = 0; t < 10; t++) {
+                    Inputs inputs;
+                    inputs.player1 = multiBallComputerMove(game, game.player1);
+                    inputs.player2 = multiBallComputerMove(game, game.player2);
+                    stepMultiBall(game, inputs);
+                }
+                ticks += 10;
+                seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            }
+            double nsPerTick = seconds * 1e9 / ticks;
+
+            // Пары сетки против полного перебора на том же состоянии. Перебор квадратичный,
+            // поэтому на самых больших аренах только оценивается по времени меньшей.
+            long long gridPairs = 0;
+            game.grid.forEachClosePair([&](int, int) { gridPairs++; });
+            char brute[32] = "-";
+            const char* pairs = "-";
+            if (ballCount <= 10000) {
+                Clock::time_point bruteStart = Clock::now();
+                long long brutePairs = countClosePairsBrute(game.balls);
+                snprintf(brute, sizeof(brute), "%.0f",
+                         std::chrono::duration<double, std::nano>(Clock::now() - bruteStart).count());
+                pairs = brutePairs == gridPairs ? "ok" : "MISMATCH";
+                if (brutePairs != gridPairs) status = 1;
+            }
+
+            char name[16];
+            snprintf(name, sizeof(name), "%dx%d", field[0], field[1]);
+            printf("%-10s %7d %6d %9lld %11.0f %11.1f %12.2f %12s  %s\n", name, ballCount,
+                   game.grid.getCellSize(), ticks, nsPerTick, nsPerTick / ballCount,
+                   static_cast<double>(game.collisions - collisionsBefore) / ticks, brute, pairs);
+        }
+    }
+    return status;
+}
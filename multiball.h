@@ -0,0 +1,127 @@
+#ifndef PONG_MULTIBALL_H
+#define PONG_MULTIBALL_H
+
+// Арена на много мячей: поле любого размера, две ракетки и от десятков до тысяч мячей.
+// Каждый мяч летит по тем же правилам, что и в обычной партии (Ball, проверка ракеток по пути
+// за тик). Очко считается за каждый мяч, вылетевший за край, и подаётся заново только он.
+// Мячи сталкиваются друг с другом; пары-кандидаты даёт равномерная сетка, поэтому тик
+// остаётся почти линейным по числу мячей, а не квадратичным.
+
+#include "game.h"
+
+#include <algorithm>
+#include <vector>
+
+// Равномерная сетка по полю: квадратные ячейки по 2^shift клеток, номера мячей отсортированы
+// по ячейкам подсчётом. Ячейка не меньше двух клеток, поэтому мячи ближе клетки друг к другу
+// лежат в одной или в соседних ячейках.
+class BallGrid {
+private:
+    int shift;  // Ячейка — 1 << shift долей клетки (BALL_SHIFT + log2 размера в клетках).
+    int columns, rows;
+    std::vector<int> cellStart;  // Начало ячейки в order; последний элемент — число мячей.
+    std::vector<int> order;      // Номера мячей подряд по ячейкам.
+    std::vector<int> cellOf;     // Ячейка каждого мяча.
+    std::vector<int> sortedX, sortedY;  // Позиции мячей в порядке order.
+
+    bool close(int k, int j) const {
+        int dx = sortedX[k] - sortedX[j], dy = sortedY[k] - sortedY[j];
+        return dx > -BALL_ONE && dx < BALL_ONE && dy > -BALL_ONE && dy < BALL_ONE;
+    }
+
+    int column(int x) const { return std::max(0, std::min(x >> shift, columns - 1)); }
+    int row(int y) const { return std::max(0, std::min(y >> shift, rows - 1)); }
+
+public:
+    BallGrid();
+
+    // Размер ячеек под поле и число мячей: ячеек не больше, чем вчетверо больше мячей,
+    // иначе на редком поле обход пустых ячеек дороже самих мячей.
+    void resize(int field_width, int field_height, int ballCount);
+    void build(const std::vector<Ball>& balls);
+
+    int getCellSize() const { return 1 << (shift - BALL_SHIFT); }
+    int getCellCount() const { return columns * rows; }
+
+    // Пары мячей ближе клетки друг к другу по обеим осям: fn(a, b), каждая пара один раз.
+    // Соседей «вперёд» два непрерывных куска order: остаток своей ячейки вместе с правой
+    // соседней и три ячейки строкой ниже. Позиции берутся из копии, разложенной по ячейкам.
+    template <class Fn>
+    void forEachClosePair(Fn fn) const {
+        for (int cy = 0; cy < rows; cy++) {
+            for (int cx = 0; cx < columns; cx++) {
+                int cell = cy * columns + cx;
+                int begin = cellStart[cell], end = cellStart[cell + 1];
+                if (begin == end) continue;
+                int sameEnd = cellStart[cell + (cx + 1 < columns ? 2 : 1)];
+                int belowBegin = 0, belowEnd = 0;
+                if (cy + 1 < rows) {
+                    int below = cell + columns;
+                    belowBegin = cellStart[below - (cx > 0 ? 1 : 0)];
+                    belowEnd = cellStart[below + (cx + 1 < columns ? 2 : 1)];
+                }
+                for (int k = begin; k < end; k++) {
+                    for (int j = k + 1; j < sameEnd; j++) {
+                        if (close(k, j)) fn(order[k], order[j]);
+                    }
+                    for (int j = belowBegin; j < belowEnd; j++) {
+                        if (close(k, j)) fn(order[k], order[j]);
+                    }
+                }
+            }
+        }
+    }
+
+    // Мячи из ячеек, которые задевают прямоугольник клеток [x0, x1) x [y0, y1): fn(index).
+    // Отрисовка окна обходит только видимые ячейки, а не все мячи поля.
+    template <class Fn>
+    void forEachInRect(int x0, int y0, int x1, int y1, Fn fn) const {
+        if (order.empty() || x1 <= x0 || y1 <= y0) return;
+        int c0 = column(x0 * BALL_ONE), c1 = column((x1 - 1) * BALL_ONE);
+        int r0 = row(y0 * BALL_ONE), r1 = row((y1 - 1) * BALL_ONE);
+        for (int cy = r0; cy <= r1; cy++) {
+            for (int cx = c0; cx <= c1; cx++) {
+                int cell = cy * columns + cx;
+                for (int j = cellStart[cell]; j < cellStart[cell + 1]; j++) fn(order[j]);
+            }
+        }
+    }
+
+    // Мячи ближе клетки друг к другу по обеим осям.
+    static bool close(const Ball& a, const Ball& b) {
+        int dx = a.getFixedX() - b.getFixedX(), dy = a.getFixedY() - b.getFixedY();
+        return dx > -BALL_ONE && dx < BALL_ONE && dy > -BALL_ONE && dy < BALL_ONE;
+    }
+};
+
+struct MultiBallGame {
+    int field_width;
+    int field_height;
+    Paddle player1;
+    Paddle player2;
+    std::vector<Ball> balls;
+    BallPhysics physics;
+    int player1Score;
+    int player2Score;
+    long long tick;
+    long long collisions;  // Столкновений мячей с начала арены.
+    Rng rng;               // Строки, из которых подаются мячи после очка.
+    BallGrid grid;         // По позициям мячей в конце последнего тика (для отрисовки окна).
+};
+
+// Арена по настройкам (поле, ракетки, параметры мяча) с ballCount мячами в случайных
+// местах и направлениях; одинаковый seed — одинаковая арена.
+MultiBallGame newMultiBallGame(const Config& config, int ballCount, uint64_t seed);
+
+// Тик: полёт мячей, ввод, удары о ракетки, очко за каждый вылетевший мяч, затем
+// столкновения мячей между собой (упругие, равные массы: мячи обмениваются скоростями).
+void stepMultiBall(MultiBallGame& game, const Inputs& inputs);
+
+// Ход компьютера за ракетку: к мячу, который раньше всех долетит до её колонки.
+int multiBallComputerMove(const MultiBallGame& game, const Paddle& paddle);
+
+// Бенчмарк: время тика при росте числа мячей и размера поля, сверка пар сетки с полным
+// перебором и его время для сравнения. Возвращает код завершения процесса.
+int runMultiBallBenchmark(const Config& config, uint64_t seed);
+
+#endif
@@ -0,0 +1,493 @@
+#include "net.h"
+#include "codec.h"
+#include "config.h"
+#include "replay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Типы пакетов. Первый байт пакета — тип.
+enum PacketType {
+    PACKET_HELLO = 1,    // Клиент → хост: версия протокола, имя игрока.
+    PACKET_WELCOME = 2,  // Хост → клиент: настройки партии, задержка ввода, имена.
+    PACKET_INPUT = 3,    // Ввод за несколько тиков подряд и подтверждение ввода соперника.
+    PACKET_BYE = 4       // Игрок вышел.
+};
+
+static const int PROTOCOL_VERSION = 2;  // 2: параметры мяча в приветствии.
+static const int MAX_INPUT_DELAY = 30;
+static const int MAX_INPUTS_PER_PACKET = 128;
+static const int SEND_INTERVAL_MS = 16;  // Не чаще ~60 пакетов в секунду: при частых тиках ввод идёт пачками.
+static const int KEEPALIVE_MS = 50;      // Повтор неподтверждённого ввода, даже если новых тиков нет.
+static const int HELLO_INTERVAL_MS = 100;
+
+static long long nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int openSocket(int port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool sameAddress(const sockaddr_in& a, const sockaddr_in& b) {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+static void putString(std::string& out, const std::string& value) {
+    putVarint(out, value.size());
+    out += value;
+}
+
+static std::string readString(Reader& in) {
+    uint64_t length = in.varint();
+    if (length > 64) {
+        in.ok = false;
+        return std::string();
+    }
+    return in.bytes(static_cast<size_t>(length));
+}
+
+// Заглушка до начала партии: настоящее поле приходит в reset().
+static GameState emptyGame() {
+    Config config{};
+    config.field_width = 8;
+    config.field_height = 6;
+    config.paddle_height = 1;
+    return newGame(config, MODE_VERSUS);
+}
+
+NetSession::NetSession()
+    : host(false), sock(-1), connected(false), peerLeft(false), inputDelay(2),
+      state(emptyGame()), currentTick(0), confirmedRemote(-1), remoteAck(-1), lastLocalTick(-1),
+      linkRng(nowMs()), lastRemoteStamp(0), lastRemoteStampMs(0), lastSentTick(-1), lastSendMs(0), lastHelloMs(0) {
+    memset(&peer, 0, sizeof(peer));
+}
+
+NetSession::~NetSession() {
+    if (sock >= 0) ::close(sock);
+}
+
+// Новая партия. Ввод за первые inputDelay тиков у обоих игроков нулевой и считается известным.
+void NetSession::reset(const Config& newConfig) {
+    config = newConfig;
+    state = newGame(config, MODE_VERSUS);
+    states.assign(WINDOW, state);
+    currentTick = 0;
+    confirmedRemote = inputDelay - 1;
+    remoteAck = inputDelay - 1;
+    lastLocalTick = inputDelay - 1;
+    lastSentTick = inputDelay - 1;
+    for (int i = 0; i < WINDOW; i++) {
+        localInputs[i] = 0;
+        remoteInputs[i] = 0;
+        usedRemote[i] = 0;
+        remoteTicks[i] = i < inputDelay ? i : -1;
+    }
+}
+
+bool NetSession::listen(int port, const Config& hostConfig, int delay) {
+    sock = openSocket(port);
+    if (sock < 0) return false;
+    host = true;
+    inputDelay = std::max(0, std::min(delay, MAX_INPUT_DELAY));
+    config = hostConfig;
+    return true;
+}
+
+bool NetSession::join(const std::string& address, const Config& clientConfig) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) return false;
+    std::string hostName = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+    if (hostName.empty()) hostName = "127.0.0.1";
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(hostName.c_str(), port.c_str(), &hints, &result) != 0 || !result) return false;
+    memcpy(&peer, result->ai_addr, sizeof(peer));
+    freeaddrinfo(result);
+
+    sock = openSocket(0);
+    if (sock < 0) return false;
+    host = false;
+    config = clientConfig;
+    return true;
+}
+
+int NetSession::getLocalPort() const {
+    sockaddr_in address;
+    socklen_t length = sizeof(address);
+    if (sock < 0 || getsockname(sock, reinterpret_cast<sockaddr*>(&address), &length) != 0) return -1;
+    return ntohs(address.sin_port);
+}
+
+// Все исходящие пакеты идут через имитатор сети: при нулевых условиях пакет уходит сразу.
+void NetSession::sendRaw(const std::string& data) {
+    if (link.lossPercent > 0 && linkRng.range(100) < link.lossPercent) {
+        stats.packetsDropped++;
+        return;
+    }
+    int delayMs = link.latencyMs;
+    if (link.jitterMs > 0) delayMs += linkRng.range(2 * link.jitterMs + 1) - link.jitterMs;
+    if (delayMs > 0) {
+        outgoing.push_back(Pending{nowMs() + delayMs, data});
+        return;
+    }
+    sendto(sock, data.data(), data.size(), 0, reinterpret_cast<const sockaddr*>(&peer), sizeof(peer));
+    stats.packetsSent++;
+}
+
+// Весь ввод, который соперник ещё не подтвердил, одним пакетом.
+void NetSession::sendInputs(long long now) {
+    long long first = remoteAck + 1;
+    long long count = std::min<long long>(lastLocalTick - first + 1, MAX_INPUTS_PER_PACKET);
+    if (count < 0) count = 0;
+
+    std::string packet;
+    packet.push_back(static_cast<char>(PACKET_INPUT));
+    putVarint(packet, static_cast<uint32_t>(now));
+    putVarint(packet, lastRemoteStamp);
+    putVarint(packet, static_cast<uint64_t>(std::max(0LL, now - lastRemoteStampMs)));  // Сколько штамп пролежал у нас.
+    putSigned(packet, confirmedRemote);
+    putVarint(packet, static_cast<uint64_t>(first));
+    putVarint(packet, static_cast<uint64_t>(count));
+    for (long long t = first; t < first + count; t++) {
+        packet.push_back(static_cast<char>(localInputs[t % WINDOW]));
+    }
+    sendRaw(packet);
+    lastSentTick = lastLocalTick;
+    lastSendMs = now;
+}
+
+void NetSession::poll() {
+    if (sock < 0) return;
+    long long now = nowMs();
+
+    unsigned char buffer[1500];
+    for (;;) {
+        sockaddr_in from;
+        socklen_t length = sizeof(from);
+        ssize_t size = recvfrom(sock, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&from), &length);
+        if (size < 0) break;
+        stats.packetsReceived++;
+        handlePacket(buffer, static_cast<size_t>(size), from);
+    }
+
+    if (!host && !connected && now - lastHelloMs >= HELLO_INTERVAL_MS) {
+        std::string packet;
+        packet.push_back(static_cast<char>(PACKET_HELLO));
+        putVarint(packet, PROTOCOL_VERSION);
+        putString(packet, config.name_Player1);
+        sendRaw(packet);
+        lastHelloMs = now;
+    }
+
+    if (connected && !peerLeft) {
+        bool fresh = lastLocalTick > lastSentTick && now - lastSendMs >= SEND_INTERVAL_MS;
+        bool keepalive = now - lastSendMs >= KEEPALIVE_MS;
+        if (fresh || keepalive) sendInputs(now);
+    }
+
+    // Пакеты, задержанные имитатором, уходят в срок (при разбросе задержки — не по порядку).
+    for (size_t i = 0; i < outgoing.size();) {
+        if (outgoing[i].releaseMs <= now) {
+            sendto(sock, outgoing[i].data.data(), outgoing[i].data.size(), 0,
+                   reinterpret_cast<const sockaddr*>(&peer), sizeof(peer));
+            stats.packetsSent++;
+            outgoing.erase(outgoing.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
+void NetSession::handlePacket(const unsigned char* data, size_t size, const sockaddr_in& from) {
+    if (size == 0) return;
+    if (connected && !sameAddress(from, peer)) return;
+    Reader in(data + 1, size - 1);
+
+    switch (data[0]) {
+        case PACKET_HELLO: {
+            if (!host) return;
+            if (in.varint() != PROTOCOL_VERSION) return;
+            std::string name = readString(in);
+            if (!in.ok) return;
+            if (!connected) {
+                peer = from;
+                Config hostConfig = config;
+                hostConfig.name_Player2 = name.substr(0, 32);  // Длина имени по схеме настроек, иначе клиент отвергнет приветствие.
+                reset(hostConfig);
+                connected = true;
+            }
+            // Ответ на каждый HELLO: приветствие могло потеряться.
+            std::string packet;
+            packet.push_back(static_cast<char>(PACKET_WELCOME));
+            uint32_t speedBits;
+            memcpy(&speedBits, &config.speed, sizeof(speedBits));
+            putVarint(packet, speedBits);
+            putVarint(packet, config.max_score);
+            putVarint(packet, config.field_width);
+            putVarint(packet, config.field_height);
+            putVarint(packet, config.paddle_height);
+            putVarint(packet, inputDelay);
+            memcpy(&speedBits, &config.ball_speed, sizeof(speedBits));
+            putVarint(packet, speedBits);
+            memcpy(&speedBits, &config.ball_max_speed, sizeof(speedBits));
+            putVarint(packet, speedBits);
+            putVarint(packet, config.ball_speedup);
+            putVarint(packet, config.ball_spin);
+            putString(packet, config.name_Player1);
+            putString(packet, config.name_Player2);
+            sendRaw(packet);
+            break;
+        }
+        case PACKET_WELCOME: {
+            if (host || connected) return;
+            Config hostConfig = config;
+            uint32_t speedBits = static_cast<uint32_t>(in.varint());
+            memcpy(&hostConfig.speed, &speedBits, sizeof(speedBits));
+            hostConfig.max_score = static_cast<int>(in.varint());
+            hostConfig.field_width = static_cast<int>(in.varint());
+            hostConfig.field_height = static_cast<int>(in.varint());
+            hostConfig.paddle_height = static_cast<int>(in.varint());
+            int delay = static_cast<int>(in.varint());
+            speedBits = static_cast<uint32_t>(in.varint());
+            memcpy(&hostConfig.ball_speed, &speedBits, sizeof(speedBits));
+            speedBits = static_cast<uint32_t>(in.varint());
+            memcpy(&hostConfig.ball_max_speed, &speedBits, sizeof(speedBits));
+            hostConfig.ball_speedup = static_cast<int>(in.varint());
+            hostConfig.ball_spin = static_cast<int>(in.varint());
+            hostConfig.name_Player1 = readString(in);
+            hostConfig.name_Player2 = readString(in);
+            // Те же пределы, что у config.ini: скорость и параметры мяча уходят прямо в цикл тиков
+            // и в newGame, поэтому NaN, бесконечность или ноль с чужой стороны не принимаются.
+            std::string error;
+            if (!in.ok || delay < 0 || delay > MAX_INPUT_DELAY || !configInRange(hostConfig, error)) return;
+            inputDelay = delay;
+            reset(hostConfig);
+            connected = true;
+            break;
+        }
+        case PACKET_INPUT: {
+            if (!connected) return;
+            uint32_t stamp = static_cast<uint32_t>(in.varint());
+            uint32_t echo = static_cast<uint32_t>(in.varint());
+            uint32_t held = static_cast<uint32_t>(in.varint());
+            long long ack = in.signedVarint();
+            long long first = static_cast<long long>(in.varint());
+            uint64_t count = in.varint();
+            if (!in.ok || count > MAX_INPUTS_PER_PACKET) return;
+            std::vector<int8_t> inputs(static_cast<size_t>(count));
+            for (uint64_t i = 0; i < count; i++) inputs[i] = static_cast<int8_t>(in.byte());
+            if (!in.ok) return;
+
+            long long now = nowMs();
+            lastRemoteStamp = stamp;
+            lastRemoteStampMs = now;
+            if (echo != 0) stats.rttMs = static_cast<int>(static_cast<uint32_t>(now) - echo - held);
+            if (ack > remoteAck) remoteAck = std::min(ack, lastLocalTick);
+            applyRemote(first, inputs);
+            break;
+        }
+        case PACKET_BYE:
+            peerLeft = true;
+            break;
+    }
+}
+
+// Ввод соперника, которого ещё не было, запоминается. Если он расходится с тем, что было
+// предсказано для уже просчитанного тика, партия пересчитывается с самого раннего такого тика.
+void NetSession::applyRemote(long long firstTick, const std::vector<int8_t>& inputs) {
+    long long mismatch = LLONG_MAX;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        long long tick = firstTick + static_cast<long long>(i);
+        if (tick <= confirmedRemote) continue;
+        if (tick >= confirmedRemote + WINDOW / 2) break;  // Так далеко соперник забежать не может.
+        int slot = static_cast<int>(tick % WINDOW);
+        if (remoteTicks[slot] == tick) continue;
+        remoteTicks[slot] = tick;
+        remoteInputs[slot] = inputs[i];
+        if (tick < currentTick && usedRemote[slot] != inputs[i]) mismatch = std::min(mismatch, tick);
+    }
+    while (remoteTicks[(confirmedRemote + 1) % WINDOW] == confirmedRemote + 1) confirmedRemote++;
+
+    if (mismatch < currentTick) rollback(mismatch);
+}
+
+// Предсказание: соперник продолжает делать то же, что в последнем известном тике.
+int8_t NetSession::predictedRemote() const {
+    if (confirmedRemote < 0) return 0;
+    return remoteInputs[confirmedRemote % WINDOW];
+}
+
+void NetSession::simulate(long long tick) {
+    int slot = static_cast<int>(tick % WINDOW);
+    states[slot] = state;
+    int8_t remote = remoteTicks[slot] == tick ? remoteInputs[slot] : predictedRemote();
+    usedRemote[slot] = remote;
+
+    Inputs inputs;
+    inputs.player1 = host ? localInputs[slot] : remote;
+    inputs.player2 = host ? remote : localInputs[slot];
+    if (!state.finished) step(state, inputs);
+}
+
+void NetSession::rollback(long long tick) {
+    auto start = std::chrono::steady_clock::now();
+    long long target = currentTick;
+    state = states[tick % WINDOW];
+    for (long long t = tick; t < target; t++) simulate(t);
+
+    stats.rollbacks++;
+    stats.resimulatedTicks += target - tick;
+    stats.maxRollback = std::max(stats.maxRollback, target - tick);
+    stats.resimulationNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool NetSession::advance(int localMove) {
+    if (!connected || peerLeft || state.finished) return false;
+    // Кольцо истории ограничивает глубину отката: дальше вперёд соперника не уходим.
+    if (currentTick - confirmedRemote > MAX_PREDICTION) {
+        stats.stalls++;
+        return false;
+    }
+
+    long long inputTick = currentTick + inputDelay;
+    localInputs[inputTick % WINDOW] = static_cast<int8_t>(std::max(-100, std::min(localMove, 100)));
+    lastLocalTick = inputTick;
+
+    simulate(currentTick);
+    currentTick++;
+    return true;
+}
+
+void NetSession::leave() {
+    if (sock < 0 || !connected) return;
+    std::string packet(1, static_cast<char>(PACKET_BYE));
+    // BYE идёт мимо имитатора и с повтором: после него сессия закрывается.
+    for (int i = 0; i < 3; i++) {
+        sendto(sock, packet.data(), packet.size(), 0, reinterpret_cast<const sockaddr*>(&peer), sizeof(peer));
+    }
+}
+
+// Бот самопроверки: догоняет мяч, но иногда пропускает ход, чтобы ввод был непредсказуемым.
+static int selfTestMove(const GameState& state, bool player1, Rng& rng) {
+    if (rng.range(3) == 0) return 0;
+    return computerMove(state, player1 ? state.player1 : state.player2);
+}
+
+// Один участник самопроверки в реальном времени: тик раз в tickMs, пока партия не закончится
+// или не будет сыграно ticks тиков, затем ожидание, пока соперник получит весь наш ввод.
+static void selfTestPeer(NetSession& session, int ticks, double tickMs, uint64_t seed, std::atomic<bool>& failed) {
+    using Clock = std::chrono::steady_clock;
+    Rng rng(seed);
+    const Clock::duration tickStep = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(tickMs));
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(10) +
+        std::chrono::duration_cast<Clock::duration>(tickStep * ticks * 3);
+    Clock::time_point nextTick = Clock::now();
+
+    for (;;) {
+        session.poll();
+        Clock::time_point now = Clock::now();
+        if (now > deadline || session.hasPeerLeft()) {
+            failed = true;
+            return;
+        }
+        bool done = session.getState().finished ? session.finishedConfirmed()
+                                                : session.getTick() >= ticks && session.getConfirmedTick() >= ticks - 1;
+        if (done && session.allAcknowledged()) break;
+
+        if (session.isConnected() && session.getTick() < ticks && now >= nextTick) {
+            const GameState& state = session.getState();
+            if (session.advance(selfTestMove(state, session.isHost(), rng))) nextTick += tickStep;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    // Последний пакет мог застрять в имитаторе задержки.
+    Clock::time_point linger = Clock::now() + std::chrono::milliseconds(200);
+    while (Clock::now() < linger) {
+        session.poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int runNetSelfTest(const Config& config, const LinkConditions& conditions, int delay, int ticks, int tickRate) {
+    NetSession host;
+    NetSession client;
+    Config clientConfig = config;
+    clientConfig.name_Player1 = config.name_Player2;
+    if (!host.listen(0, config, delay)) {
+        fprintf(stderr, "Cannot open UDP socket\n");
+        return 1;
+    }
+    if (!client.join("127.0.0.1:" + std::to_string(host.getLocalPort()), clientConfig)) {
+        fprintf(stderr, "Cannot connect to 127.0.0.1:%d\n", host.getLocalPort());
+        return 1;
+    }
+    host.setLinkConditions(conditions);
+    client.setLinkConditions(conditions);
+
+    double tickMs = 1000.0 / std::max(tickRate, 1);
+    printf("Net self-test: %d ticks at %d Hz, latency %d ms, jitter %d ms, loss %d%% each way, input delay %d\n",
+           ticks, tickRate, conditions.latencyMs, conditions.jitterMs, conditions.lossPercent, delay);
+
+    std::atomic<bool> failed(false);
+    std::thread clientThread(selfTestPeer, std::ref(client), ticks, tickMs, 2, std::ref(failed));
+    selfTestPeer(host, ticks, tickMs, 1, failed);
+    clientThread.join();
+
+    std::string hostState;
+    std::string clientState;
+    encodeGameState(hostState, host.getState());
+    encodeGameState(clientState, client.getState());
+    bool converged = !failed && host.getTick() == client.getTick() && hostState == clientState;
+
+    const NetSession* sessions[2] = {&host, &client};
+    const char* names[2] = {"host", "client"};
+    for (int i = 0; i < 2; i++) {
+        const NetStats& s = sessions[i]->getStats();
+        long long played = std::max(sessions[i]->getTick(), 1LL);
+        printf("%-6s: %lld ticks, score %d:%d, rollbacks %lld (%.1f%% of ticks), resimulated %lld ticks "
+               "(avg %.1f, max %lld), resim %.0f ns/tick, %.3f ms total\n",
+               names[i], sessions[i]->getTick(), sessions[i]->getState().player1Score,
+               sessions[i]->getState().player2Score, s.rollbacks, 100.0 * s.rollbacks / played, s.resimulatedTicks,
+               s.rollbacks ? static_cast<double>(s.resimulatedTicks) / s.rollbacks : 0.0, s.maxRollback,
+               s.resimulatedTicks ? s.resimulationNs / s.resimulatedTicks : 0.0, s.resimulationNs / 1e6);
+        printf("        stalls %lld, packets sent %lld, received %lld, dropped %lld, rtt %d ms\n", s.stalls,
+               s.packetsSent, s.packetsReceived, s.packetsDropped, s.rttMs);
+    }
+    int rtt = std::max(host.getStats().rttMs, 0);
+    printf("Suggested input delay for this link: %d ticks\n",
+           static_cast<int>(std::ceil(rtt / 2.0 / tickMs)));
+    printf("%s\n", converged ? "Peers converged to identical state" : "DESYNC: peers ended in different states");
+    return converged ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+#ifndef PONG_NET_H
+#define PONG_NET_H
+
+// Сетевая игра Player vs Player по UDP с предсказанием и откатом (rollback).
+//
+// По сети идут только кадры ввода: у каждого тика свой ввод каждого игрока (сдвиг ракетки).
+// Свой ввод применяется с задержкой inputDelay тиков, ввод соперника, который ещё не пришёл,
+// предсказывается повтором последнего известного. Когда настоящий ввод расходится с предсказанием,
+// партия откатывается к сохранённому состоянию этого тика и пересчитывается до текущего.
+// В каждом пакете — весь ввод, который соперник ещё не подтвердил, поэтому потери не страшны.
+//
+// Хост играет за игрока 1 и рассылает настройки партии, подключившийся — за игрока 2.
+
+#include "game.h"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+
+// Имитация плохой сети на исходящих пакетах: задержка, разброс задержки и потери.
+struct LinkConditions {
+    int latencyMs = 0;
+    int jitterMs = 0;
+    int lossPercent = 0;
+};
+
+// Статистика сессии.
+struct NetStats {
+    long long rollbacks = 0;         // Сколько раз пришлось откатываться.
+    long long resimulatedTicks = 0;  // Сколько тиков пересчитано при откатах.
+    long long maxRollback = 0;       // Самый глубокий откат в тиках.
+    double resimulationNs = 0;       // Время всех пересчётов.
+    long long stalls = 0;            // Тики, пропущенные из-за слишком далёкого забегания вперёд.
+    long long packetsSent = 0;
+    long long packetsReceived = 0;
+    long long packetsDropped = 0;    // Выброшено имитатором потерь.
+    int rttMs = -1;                  // Последняя оценка времени туда-обратно.
+};
+
+class NetSession {
+public:
+    static const int WINDOW = 256;         // Глубина истории состояний и ввода.
+    static const int MAX_PREDICTION = 32;  // Насколько тиков можно забежать вперёд соперника.
+
+private:
+    struct Pending {
+        long long releaseMs;
+        std::string data;
+    };
+
+    bool host;
+    int sock;
+    sockaddr_in peer;
+    bool connected;
+    bool peerLeft;
+    int inputDelay;
+
+    Config config;
+    GameState state;
+    long long currentTick;      // Сколько тиков просчитано; state — состояние в начале этого тика.
+    long long confirmedRemote;  // Ввод соперника известен для всех тиков <= confirmedRemote.
+    long long remoteAck;        // Соперник подтвердил наш ввод до этого тика.
+    long long lastLocalTick;    // Последний тик, для которого задан наш ввод.
+
+    std::vector<GameState> states;  // Кольцо состояний по тикам (WINDOW).
+    int8_t localInputs[WINDOW];
+    int8_t remoteInputs[WINDOW];
+    long long remoteTicks[WINDOW];  // Для какого тика лежит ввод соперника в ячейке (-1 — нет).
+    int8_t usedRemote[WINDOW];      // С каким вводом соперника тик был просчитан.
+
+    LinkConditions link;
+    Rng linkRng;
+    std::deque<Pending> outgoing;
+    uint32_t lastRemoteStamp;
+    long long lastRemoteStampMs;
+    long long lastSentTick;
+    long long lastSendMs;
+    long long lastHelloMs;
+    NetStats stats;
+
+    void sendRaw(const std::string& data);
+    void sendInputs(long long nowMs);
+    void handlePacket(const unsigned char* data, size_t size, const sockaddr_in& from);
+    void applyRemote(long long firstTick, const std::vector<int8_t>& inputs);
+    void simulate(long long tick);
+    void rollback(long long tick);
+    int8_t predictedRemote() const;
+    void reset(const Config& newConfig);
+
+public:
+    NetSession();
+    ~NetSession();
+    NetSession(const NetSession&) = delete;
+    NetSession& operator=(const NetSession&) = delete;
+
+    // Хост: слушает порт и ждёт соперника.
+    bool listen(int port, const Config& hostConfig, int delay);
+    // Подключение к хосту "адрес:порт".
+    bool join(const std::string& address, const Config& clientConfig);
+
+    void setLinkConditions(const LinkConditions& conditions) { link = conditions; }
+
+    // Приём пакетов, отправка отложенных имитатором, повтор рукопожатия. Вызывать часто.
+    void poll();
+
+    // Следующий тик с нашим вводом localMove. false — тик не сделан: нет соперника или
+    // мы слишком далеко впереди него (ввод тогда не теряется, вызывающий повторит его позже).
+    bool advance(int localMove);
+
+    // Сообщить сопернику о выходе.
+    void leave();
+
+    // Весь наш ввод дошёл до соперника: после конца партии можно закрывать сессию.
+    bool allAcknowledged() const { return remoteAck >= lastLocalTick; }
+
+    bool isHost() const { return host; }
+    bool isConnected() const { return connected; }
+    bool hasPeerLeft() const { return peerLeft; }
+    const GameState& getState() const { return state; }
+    const Config& getConfig() const { return config; }
+    long long getTick() const { return currentTick; }
+    long long getConfirmedTick() const { return confirmedRemote; }
+    // Партия закончилась в состоянии, подтверждённом вводом обоих игроков.
+    bool finishedConfirmed() const { return state.finished && confirmedRemote >= currentTick - 1; }
+    const NetStats& getStats() const { return stats; }
+    int getInputDelay() const { return inputDelay; }
+    int getLocalPort() const;
+};
+
+// Проверка на localhost: хост и клиент в двух потоках играют ботами через имитатор плохой сети,
+// затем сравниваются их состояния. Отчёт об откатах и стоимости пересчёта в stdout.
+int runNetSelfTest(const Config& config, const LinkConditions& conditions, int delay, int ticks, int tickRate);
+
+#endif
@@ -0,0 +1,72 @@
+#include "pool.h"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Очередь одного потока. Выравнивание убирает ложное разделение кэш-линий между потоками.
+struct alignas(64) WorkerQueue {
+    std::mutex lock;
+    std::deque<int> tasks;
+
+    bool popFront(int& task) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (tasks.empty()) return false;
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+
+    bool stealBack(int& task) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (tasks.empty()) return false;
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+};
+
+}
+
+int defaultThreadCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? static_cast<int>(n) : 1;
+}
+
+void runWorkStealing(int threads, int count, const std::function<void(int task, int worker)>& fn) {
+    if (threads < 1) threads = 1;
+    if (count <= 0) return;
+
+    std::vector<WorkerQueue> queues(threads);
+    for (int w = 0; w < threads; w++) {
+        // Непрерывный блок задач на поток: соседние задачи выполняются одним потоком.
+        int begin = static_cast<int>(static_cast<long long>(count) * w / threads);
+        int end = static_cast<int>(static_cast<long long>(count) * (w + 1) / threads);
+        for (int t = begin; t < end; t++) queues[w].tasks.push_back(t);
+    }
+
+    auto worker = [&](int self) {
+        int task;
+        while (true) {
+            if (queues[self].popFront(task)) {
+                fn(task, self);
+                continue;
+            }
+            // Своя очередь пуста: обходим остальных, начиная со следующего потока.
+            bool stolen = false;
+            for (int i = 1; i < threads && !stolen; i++) {
+                stolen = queues[(self + i) % threads].stealBack(task);
+            }
+            if (!stolen) return;  // Новых задач не появляется, значит работа закончена.
+            fn(task, self);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int w = 1; w < threads; w++) pool.emplace_back(worker, w);
+    worker(0);  // Вызывающий поток работает наравне с остальными.
+    for (std::thread& t : pool) t.join();
+}
@@ -0,0 +1,17 @@
+#ifndef PONG_POOL_H
+#define PONG_POOL_H
+
+#include <functional>
+
+// Пул потоков с отдельной очередью (deque) у каждого потока и кражей работы.
+// Задачи с номерами [0, count) сначала делятся между потоками непрерывными блоками;
+// поток берёт задачи с начала своей очереди, а освободившийся поток крадёт с конца чужой.
+// fn(task, worker) вызывается ровно один раз для каждой задачи; worker — номер потока
+// в [0, threads), его удобно использовать как индекс собственного буфера результатов.
+// Возвращает управление, когда выполнены все задачи.
+void runWorkStealing(int threads, int count, const std::function<void(int task, int worker)>& fn);
+
+// Число потоков по умолчанию: все ядра машины.
+int defaultThreadCount();
+
+#endif
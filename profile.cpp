@@ -0,0 +1,121 @@
+#include "profile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+Profiler profiler;
+
+static const char* const PHASE_NAMES[PHASE_COUNT] = {"input", "sim", "draw", "refresh", "frame", "jitter"};
+
+const char* phaseName(ProfilePhase phase) {
+    return PHASE_NAMES[phase];
+}
+
+void Histogram::reset() {
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    maxValue = 0;
+    sum = 0;
+}
+
+int Histogram::bucketOf(uint64_t value) {
+    if (value < 4) return static_cast<int>(value);
+    int msb = 63 - __builtin_clzll(value);
+    int fraction = static_cast<int>((value >> (msb - 2)) & 3);  // Два бита после старшего.
+    return msb * 4 + fraction;
+}
+
+uint64_t Histogram::bucketLimit(int bucket) {
+    if (bucket < 4) return static_cast<uint64_t>(bucket);
+    int msb = bucket / 4, fraction = bucket % 4;
+    uint64_t base = 1ull << msb;
+    uint64_t step = base >> 2;
+    return base + step * (fraction + 1) - 1;
+}
+
+uint64_t Histogram::percentile(double p) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(p * (count - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) return bucketLimit(i) < maxValue ? bucketLimit(i) : maxValue;
+    }
+    return maxValue;
+}
+
+Profiler::Profiler() : startTicks(now()), startTime(std::chrono::steady_clock::now()), lastFrame(0) {}
+
+void Profiler::frame(double targetNs) {
+    uint64_t current = now();
+    if (lastFrame != 0) {
+        uint64_t interval = current - lastFrame;
+        phases[PHASE_FRAME].add(interval);
+        double targetTicks = targetNs / nanosPerTick();
+        double deviation = interval > targetTicks ? interval - targetTicks : targetTicks - interval;
+        phases[PHASE_JITTER].add(static_cast<uint64_t>(deviation));
+    }
+    lastFrame = current;
+}
+
+double Profiler::nanosPerTick() const {
+#if defined(__x86_64__) || defined(__i386__)
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+    uint64_t ticks = now() - startTicks;
+    return ticks > 0 && ns > 0 ? ns / ticks : 1.0;
+#else
+    return 1.0;  // Без TSC тики и есть наносекунды steady_clock.
+#endif
+}
+
+void Profiler::reset() {
+    for (Histogram& histogram : phases) histogram.reset();
+    lastFrame = 0;
+}
+
+// Время в наносекундах в удобных единицах.
+static void formatTime(char* text, size_t size, double ns) {
+    if (ns >= 1e6) snprintf(text, size, "%.1fms", ns / 1e6);
+    else if (ns >= 1e3) snprintf(text, size, "%.1fus", ns / 1e3);
+    else snprintf(text, size, "%.0fns", ns);
+}
+
+void Profiler::describe(ProfilePhase phase, char* text, size_t size) const {
+    const Histogram& histogram = phases[phase];
+    double scale = nanosPerTick();
+    char p50[16], p99[16], max[16];
+    formatTime(p50, sizeof(p50), histogram.percentile(0.50) * scale);
+    formatTime(p99, sizeof(p99), histogram.percentile(0.99) * scale);
+    formatTime(max, sizeof(max), histogram.getMax() * scale);
+    snprintf(text, size, "%-8s p50 %-8s p99 %-8s max %-8s n=%llu", phaseName(phase), p50, p99, max,
+             static_cast<unsigned long long>(histogram.getCount()));
+}
+
+bool Profiler::write(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) return false;
+    double scale = nanosPerTick();
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+
+    if (json) file << "{\n";
+    else file << "phase,count,mean_ns,p50_ns,p99_ns,max_ns\n";
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const Histogram& h = phases[i];
+        char line[256];
+        if (json) {
+            snprintf(line, sizeof(line),
+                     "  \"%s\": {\"count\": %llu, \"mean_ns\": %.1f, \"p50_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f}%s\n",
+                     PHASE_NAMES[i], static_cast<unsigned long long>(h.getCount()), h.getMean() * scale,
+                     h.percentile(0.50) * scale, h.percentile(0.99) * scale, h.getMax() * scale,
+                     i + 1 < PHASE_COUNT ? "," : "");
+        } else {
+            snprintf(line, sizeof(line), "%s,%llu,%.1f,%.1f,%.1f,%.1f\n", PHASE_NAMES[i],
+                     static_cast<unsigned long long>(h.getCount()), h.getMean() * scale, h.percentile(0.50) * scale,
+                     h.percentile(0.99) * scale, h.getMax() * scale);
+        }
+        file << line;
+    }
+    if (json) file << "}\n";
+    return static_cast<bool>(file);
+}
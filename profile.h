@@ -0,0 +1,122 @@
+#ifndef PONG_PROFILE_H
+#define PONG_PROFILE_H
+
+// Инструментирование игрового цикла: таймеры фаз кадра, гистограммы (p50/p99/max)
+// и дрожание кадров. Время берётся из TSC (на x86) и пересчитывается в наносекунды
+// по steady_clock в момент отчёта, поэтому калибровка не задерживает запуск.
+//
+// Сборка с -DPONG_NO_PROFILE (make PROFILE=0) превращает PROFILE_SCOPE и PROFILE_FRAME
+// в пустые макросы: в игровом цикле не остаётся ни одной инструкции замера.
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+enum ProfilePhase {
+    PHASE_INPUT = 0,    // Выборка ввода (getch).
+    PHASE_SIM = 1,      // Тики физики: step(), ИИ, запись повтора.
+    PHASE_DRAW = 2,     // Рисование кадра в буфер.
+    PHASE_REFRESH = 3,  // Вывод изменений на терминал (FrameBuffer::flush, refresh()).
+    PHASE_FRAME = 4,    // Интервал между кадрами.
+    PHASE_JITTER = 5,   // Отклонение интервала кадра от 1 / frame_rate.
+    PHASE_COUNT = 6
+};
+
+// Гистограмма фиксированного размера: 4 корзины на каждую степень двойки (ошибка квантиля до 19%).
+class Histogram {
+public:
+    static const int BUCKETS = 64 * 4;
+
+private:
+    uint64_t buckets[BUCKETS];
+    uint64_t count;
+    uint64_t maxValue;
+    uint64_t sum;
+
+public:
+    Histogram() { reset(); }
+
+    void reset();
+    void add(uint64_t value) {
+        buckets[bucketOf(value)]++;
+        count++;
+        sum += value;
+        if (value > maxValue) maxValue = value;
+    }
+
+    uint64_t getCount() const { return count; }
+    uint64_t getMax() const { return maxValue; }
+    double getMean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+    uint64_t percentile(double p) const;  // Верхняя граница корзины, в которую попал квантиль.
+
+    static int bucketOf(uint64_t value);
+    static uint64_t bucketLimit(int bucket);
+};
+
+class Profiler {
+private:
+    Histogram phases[PHASE_COUNT];       // В тиках таймера.
+    uint64_t startTicks;
+    std::chrono::steady_clock::time_point startTime;
+    uint64_t lastFrame;                  // Метка предыдущего кадра, 0 — кадров ещё не было.
+
+public:
+    Profiler();
+
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    void add(ProfilePhase phase, uint64_t ticks) { phases[phase].add(ticks); }
+
+    // Отметка нового кадра: интервал и отклонение от целевого интервала targetNs.
+    void frame(double targetNs);
+
+    const Histogram& get(ProfilePhase phase) const { return phases[phase]; }
+    double nanosPerTick() const;  // Калибровка таймера по steady_clock с момента запуска.
+    void reset();
+
+    // Итоговый дамп: JSON, если путь кончается на ".json", иначе CSV.
+    bool write(const std::string& path) const;
+
+    // Строка оверлея для фазы: "sim     p50 1.2us  p99 3.4us  max 9.9us".
+    void describe(ProfilePhase phase, char* text, size_t size) const;
+};
+
+extern Profiler profiler;
+
+// Замер времени блока до конца области видимости.
+class ScopedTimer {
+private:
+    ProfilePhase phase;
+    uint64_t start;
+
+public:
+    explicit ScopedTimer(ProfilePhase phase) : phase(phase), start(Profiler::now()) {}
+    ~ScopedTimer() { profiler.add(phase, Profiler::now() - start); }
+};
+
+const char* phaseName(ProfilePhase phase);
+
+#define PONG_PROFILE_CONCAT2(a, b) a##b
+#define PONG_PROFILE_CONCAT(a, b) PONG_PROFILE_CONCAT2(a, b)
+
+#ifdef PONG_NO_PROFILE
+#define PROFILE_ENABLED 0
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_FRAME(targetNs) ((void)0)
+#else
+#define PROFILE_ENABLED 1
+#define PROFILE_SCOPE(phase) ScopedTimer PONG_PROFILE_CONCAT(profileTimer, __LINE__)(phase)
+#define PROFILE_FRAME(targetNs) profiler.frame(targetNs)
+#endif
+
+#endif
@@ -0,0 +1,195 @@
+#include "render.h"
+#include "profile.h"
+
+#include <ncurses.h>
+#include <algorithm>
+#include <cstdio>
+
+FrameBuffer::FrameBuffer(int width, int height)
+    : width(0), height(0), fullRedraw(true), cellsEmitted(0), bytesEmitted(0) {
+    resize(width, height);
+}
+
+void FrameBuffer::resize(int newWidth, int newHeight) {
+    width = newWidth > 0 ? newWidth : 0;
+    height = newHeight > 0 ? newHeight : 0;
+    background.assign(width * height, ' ');
+    current.assign(width * height, ' ');
+    previous.assign(width * height, ' ');
+    fullRedraw = true;
+}
+
+void FrameBuffer::putStatic(int y, int x, char ch) {
+    if (x < 0 || y < 0 || x >= width || y >= height) return;
+    background[y * width + x] = ch;
+}
+
+void FrameBuffer::clearStatic() {
+    background.assign(width * height, ' ');
+}
+
+void FrameBuffer::clear() {
+    current = background;
+}
+
+void FrameBuffer::put(int y, int x, char ch) {
+    if (x < 0 || y < 0 || x >= width || y >= height) return;  // Всё, что за пределами буфера, отсекается.
+    current[y * width + x] = ch;
+}
+
+void FrameBuffer::print(int y, int x, const char* text) {
+    for (int i = 0; text[i] != '\0'; i++) {
+        put(y, x + i, text[i]);
+    }
+}
+
+// Длина escape-последовательности перемещения курсора "\033[<y>;<x>H".
+static int cursorMoveBytes(int y, int x) {
+    int bytes = 4;
+    for (int v = y + 1; v > 0; v /= 10) bytes++;
+    for (int v = x + 1; v > 0; v /= 10) bytes++;
+    return bytes;
+}
+
+void FrameBuffer::flush() {
+    PROFILE_SCOPE(PHASE_REFRESH);
+    cellsEmitted = 0;
+    bytesEmitted = 0;
+
+    if (fullRedraw) {
+        // Экран в неизвестном состоянии: очищаем его и считаем, что на нём одни пробелы.
+        erase();
+        previous.assign(width * height, ' ');
+        fullRedraw = false;
+    }
+
+    for (int y = 0; y < height; y++) {
+        const char* cur = &current[y * width];
+        char* prev = &previous[y * width];
+        int x = 0;
+        while (x < width) {
+            if (cur[x] == prev[x]) {
+                x++;
+                continue;
+            }
+            // Непрерывный отрезок изменившихся ячеек выводится одним перемещением курсора.
+            int start = x;
+            while (x < width && cur[x] != prev[x]) {
+                prev[x] = cur[x];
+                x++;
+            }
+            mvaddnstr(y, start, cur + start, x - start);
+            cellsEmitted += x - start;
+            bytesEmitted += cursorMoveBytes(y, start) + (x - start);
+        }
+    }
+
+    refresh();
+}
+
+Viewport Viewport::fit(int field_width, int field_height, int screenWidth, int screenHeight) {
+    Viewport view;
+    view.width = std::max(1, std::min(field_width, screenWidth));
+    view.height = std::max(1, std::min(field_height, screenHeight));
+    return view;
+}
+
+bool Viewport::pan(int dx, int dy, int field_width, int field_height) {
+    int newX = std::max(0, std::min(x + dx, field_width - width));
+    int newY = std::max(0, std::min(y + dy, field_height - height));
+    bool moved = newX != x || newY != y;
+    x = newX;
+    y = newY;
+    return moved;
+}
+
+bool Viewport::follow(int fieldX, int fieldY, int field_width, int field_height) {
+    int marginX = width / 4, marginY = height / 4;
+    int dx = 0, dy = 0;
+    if (fieldX < x + marginX) dx = fieldX - (x + marginX);
+    else if (fieldX >= x + width - marginX) dx = fieldX - (x + width - marginX) + 1;
+    if (fieldY < y + marginY) dy = fieldY - (y + marginY);
+    else if (fieldY >= y + height - marginY) dy = fieldY - (y + height - marginY) + 1;
+    return (dx || dy) && pan(dx, dy, field_width, field_height);
+}
+
+// Отрисовка ракетки вертикальной чертой на позиции `x`, `y`; только видимые строки.
+void drawPaddle(FrameBuffer& frame, const Paddle& paddle, const Viewport& view) {
+    if (paddle.getX() < view.x || paddle.getX() >= view.x + view.width) return;
+    int first = std::max(paddle.getY(), view.y);
+    int last = std::min(paddle.getY() + paddle.getHeight(), view.y + view.height);
+    for (int row = first; row < last; row++) {
+        frame.put(row - view.y, paddle.getX() - view.x, '|');
+    }
+}
+
+// Отрисовка мяча на экране символом `O`
+void drawBall(FrameBuffer& frame, const Ball& ball, const Viewport& view) {
+    if (view.contains(ball.getX(), ball.getY())) frame.put(ball.getY() - view.y, ball.getX() - view.x, 'O');
+}
+
+void drawFieldBorders(FrameBuffer& frame, int field_width, int field_height, bool wall, const Viewport& view) {
+    frame.clearStatic();
+    int first = std::max(0, view.x), last = std::min(field_width, view.x + view.width);
+    for (int row : {0, field_height - 1}) {
+        if (row < view.y || row >= view.y + view.height) continue;
+        for (int i = first; i < last; i++) frame.putStatic(row - view.y, i - view.x, '-');
+    }
+    if (wall && view.x <= 1 && view.x + view.width > 1) {
+        int top = std::max(1, view.y), bottom = std::min(field_height - 1, view.y + view.height);
+        for (int i = top; i < bottom; i++) frame.putStatic(i - view.y, 1 - view.x, '|');
+    }
+}
+
+void drawStaticField(FrameBuffer& frame, const GameState& state, const Viewport& view) {
+    drawFieldBorders(frame, state.field_width, state.field_height, state.mode == MODE_WALL, view);
+}
+
+CachedText::CachedText(const char* format) : format(format), first(0), second(0), valid(false) {
+    text[0] = '\0';
+}
+
+const char* CachedText::get(long long a, long long b) {
+    if (!valid || a != first || b != second) {
+        snprintf(text, sizeof(text), format, a, b);
+        first = a;
+        second = b;
+        valid = true;
+    }
+    return text;
+}
+
+MatchLabels::MatchLabels() : hasRight(false), rightColumn(0), scoreColumn(0), score("Score: %lld | %lld") {}
+
+void MatchLabels::setPlayers(const std::string& leftName, const char* rightName, int field_width) {
+    left = leftName;
+    hasRight = rightName != nullptr;
+    right = hasRight ? rightName : "";
+    rightColumn = field_width - static_cast<int>(right.size()) - 4;
+    scoreColumn = field_width / 2 - 5;
+}
+
+void MatchLabels::draw(FrameBuffer& frame, const GameState& state) {
+    // Отображение счёта
+    frame.print(1, scoreColumn, score.get(state.player1Score, state.player2Score));
+
+    // Имя игрока 1 и, справа, игрока 2 или "Computer"; против стены справа никого нет
+    frame.print(2, 0, left.c_str());
+    if (hasRight) frame.print(2, rightColumn, right.c_str());
+}
+
+void drawGame(FrameBuffer& frame, const GameState& state, MatchLabels& labels, const Viewport& view) {
+    drawPaddle(frame, state.player1, view);
+    drawPaddle(frame, state.player2, view);
+    drawBall(frame, state.ball, view);
+    labels.draw(frame, state);
+}
+
+void drawMultiBall(FrameBuffer& frame, const MultiBallGame& game, const Viewport& view) {
+    drawPaddle(frame, game.player1, view);
+    drawPaddle(frame, game.player2, view);
+    // Ячейка крупнее клетки, поэтому мячи с краёв ячеек всё равно проверяются окном.
+    game.grid.forEachInRect(view.x, view.y, view.x + std::min(view.width, game.field_width),
+                            view.y + std::min(view.height, game.field_height),
+                            [&](int index) { drawBall(frame, game.balls[index], view); });
+}
@@ -0,0 +1,115 @@
+#ifndef PONG_RENDER_H
+#define PONG_RENDER_H
+
+#include "game.h"
+#include "multiball.h"
+
+#include <string>
+#include <vector>
+
+// Кадровый буфер с сохранением предыдущего кадра (retained mode).
+// Каждый кадр рисуется в память, а flush() отправляет в терминал только ячейки,
+// которые изменились с прошлого кадра. Статичные элементы (границы поля) кладутся
+// в фоновый слой один раз и больше не выводятся, пока не изменятся.
+class FrameBuffer {
+private:
+    int width, height;
+    std::vector<char> background;  // Статичный слой, с него начинается каждый кадр.
+    std::vector<char> current;     // Кадр, который рисуется сейчас.
+    std::vector<char> previous;    // То, что уже находится на экране.
+    bool fullRedraw;               // Экран нужно перерисовать целиком (первый кадр, смена размера).
+    int cellsEmitted;              // Ячеек выведено последним flush().
+    int bytesEmitted;              // Оценка байт, ушедших в терминал последним flush().
+
+public:
+    FrameBuffer(int width, int height);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getCellsEmitted() const { return cellsEmitted; }
+    int getBytesEmitted() const { return bytesEmitted; }
+
+    void resize(int newWidth, int newHeight);
+
+    // Статичный слой: рисуется один раз, например границы поля.
+    void putStatic(int y, int x, char ch);
+    void clearStatic();
+
+    // Динамический слой: перерисовывается каждый кадр.
+    void clear();  // Начать новый кадр со статичного слоя.
+    void put(int y, int x, char ch);
+    void print(int y, int x, const char* text);
+
+    void invalidate() { fullRedraw = true; }  // Следующий flush() перерисует всё.
+    void flush();  // Вывод изменившихся ячеек и refresh().
+};
+
+// Видимая часть поля (камера): левый верхний угол и размер окна в клетках поля.
+// Рисуется только то, что попадает в окно, и со сдвигом на его угол. По умолчанию окно
+// начинается в углу поля и не ограничивает кадр — так рисуется поле, которое влезает в терминал.
+struct Viewport {
+    int x = 0, y = 0;
+    int width = 1 << 29, height = 1 << 29;
+
+    // Окно не больше экрана screenWidth x screenHeight в левом верхнем углу поля.
+    static Viewport fit(int field_width, int field_height, int screenWidth, int screenHeight);
+
+    bool contains(int fieldX, int fieldY) const {
+        return fieldX >= x && fieldX < x + width && fieldY >= y && fieldY < y + height;
+    }
+
+    // Сдвиг окна так, чтобы клетка (fieldX, fieldY) была не ближе четверти окна к его краю.
+    // true, если окно сдвинулось (статичный слой пора перерисовать).
+    bool follow(int fieldX, int fieldY, int field_width, int field_height);
+    // Сдвиг на (dx, dy) клеток в пределах поля.
+    bool pan(int dx, int dy, int field_width, int field_height);
+};
+
+// Отрисовка партии в кадр — общая для игры, повторов и зрителей.
+void drawPaddle(FrameBuffer& frame, const Paddle& paddle, const Viewport& view = Viewport());
+void drawBall(FrameBuffer& frame, const Ball& ball, const Viewport& view = Viewport());
+
+// Границы поля (и стена в режиме против стены) — в статичный слой.
+void drawStaticField(FrameBuffer& frame, const GameState& state, const Viewport& view = Viewport());
+void drawFieldBorders(FrameBuffer& frame, int field_width, int field_height, bool wall, const Viewport& view);
+
+// Строка с двумя числами по формату printf (оба — %lld). Форматируется заново только
+// когда числа меняются, между кадрами отдаётся готовая строка.
+class CachedText {
+private:
+    const char* format;
+    long long first, second;
+    bool valid;
+    char text[96];
+
+public:
+    explicit CachedText(const char* format);
+    const char* get(long long a, long long b);
+};
+
+// Подписи партии: имена с готовыми позициями и строка счёта. Имена готовятся один раз
+// на партию, счёт пересобирается только при изменении, поэтому кадр ничего не форматирует.
+class MatchLabels {
+private:
+    std::string left, right;
+    bool hasRight;
+    int rightColumn;
+    int scoreColumn;
+    CachedText score;
+
+public:
+    MatchLabels();
+
+    // right == nullptr — справа никого нет (игра против стены).
+    void setPlayers(const std::string& leftName, const char* rightName, int field_width);
+
+    void draw(FrameBuffer& frame, const GameState& state);
+};
+
+// Ракетки, мяч, счёт и имена игроков. Подписи привязаны к экрану, а не к окну на поле.
+void drawGame(FrameBuffer& frame, const GameState& state, MatchLabels& labels, const Viewport& view = Viewport());
+
+// Арена на много мячей: ракетки и мячи из ячеек сетки, которые видны в окне.
+void drawMultiBall(FrameBuffer& frame, const MultiBallGame& game, const Viewport& view);
+
+#endif
@@ -0,0 +1,429 @@
+#include "replay.h"
+#include "config.h"
+#include "pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// Версия 2 добавила параметры мяча в заголовок и хранит мяч в долях клетки.
+// Повторы версии 1 читаются как классические партии с мячом в целых клетках.
+// Версия 3 добавила в ключевые кадры очки и поле, для которых ComputerAI посчитал цель.
+static const char REPLAY_MAGIC[8] = {'P', 'O', 'N', 'G', 'R', 'P', 'L', '3'};
+static const char REPLAY_MAGIC_V2[8] = {'P', 'O', 'N', 'G', 'R', 'P', 'L', '2'};
+static const char REPLAY_MAGIC_V1[8] = {'P', 'O', 'N', 'G', 'R', 'P', 'L', '1'};
+static const unsigned char REPLAY_END = 0;
+static const unsigned char REPLAY_KEYFRAME = 1;
+static const unsigned char REPLAY_RESIZE = 2;
+
+static void putPaddle(std::string& out, const Paddle& paddle) {
+    putSigned(out, paddle.getX());
+    putSigned(out, paddle.getY());
+    putSigned(out, paddle.getHeight());
+}
+
+static void readPaddle(Reader& in, Paddle& paddle) {
+    paddle.setX(static_cast<int>(in.signedVarint()));
+    paddle.setY(static_cast<int>(in.signedVarint()));
+    paddle.setHeight(static_cast<int>(in.signedVarint()));
+}
+
+void encodeGameState(std::string& out, const GameState& state) {
+    putVarint(out, state.mode);
+    putSigned(out, state.field_width);
+    putSigned(out, state.field_height);
+    putSigned(out, state.max_score);
+    putPaddle(out, state.player1);
+    putPaddle(out, state.player2);
+    putSigned(out, state.ball.getFixedX());
+    putSigned(out, state.ball.getFixedY());
+    putSigned(out, state.ball.getDX());
+    putSigned(out, state.ball.getDY());
+    putSigned(out, state.player1Score);
+    putSigned(out, state.player2Score);
+    putVarint(out, static_cast<uint64_t>(state.tick));
+    out.push_back(state.finished ? 1 : 0);
+}
+
+bool decodeGameState(Reader& in, GameState& state, int ballScale) {
+    state.mode = static_cast<int>(in.varint());
+    state.field_width = static_cast<int>(in.signedVarint());
+    state.field_height = static_cast<int>(in.signedVarint());
+    state.max_score = static_cast<int>(in.signedVarint());
+    readPaddle(in, state.player1);
+    readPaddle(in, state.player2);
+    state.ball.setFixedX(static_cast<int>(in.signedVarint()) * ballScale);
+    state.ball.setFixedY(static_cast<int>(in.signedVarint()) * ballScale);
+    state.ball.setDX(static_cast<int>(in.signedVarint()) * ballScale);
+    state.ball.setDY(static_cast<int>(in.signedVarint()) * ballScale);
+    state.player1Score = static_cast<int>(in.signedVarint());
+    state.player2Score = static_cast<int>(in.signedVarint());
+    state.tick = static_cast<long long>(in.varint());
+    state.finished = in.byte() != 0;
+    return in.ok;
+}
+
+static void putComputer(std::string& out, const ComputerAIState& ai) {
+    putVarint(out, ai.rng);
+    out.push_back(ai.hasTarget ? 1 : 0);
+    putSigned(out, ai.cachedDX);
+    putSigned(out, ai.cachedDY);
+    putSigned(out, ai.cachedPoints);
+    putSigned(out, ai.cachedWidth);
+    putSigned(out, ai.cachedHeight);
+    putSigned(out, ai.target);
+    putSigned(out, ai.aimOffset);
+    putSigned(out, ai.reactionLeft);
+}
+
+// state — состояние того же ключевого кадра: в повторах до версии 3 ключ подачи берётся из него.
+static ComputerAIState readComputer(Reader& in, int ballScale, int version, const GameState& state) {
+    ComputerAIState ai;
+    ai.rng = in.varint();
+    ai.hasTarget = in.byte() != 0;
+    ai.cachedDX = static_cast<int>(in.signedVarint()) * ballScale;
+    ai.cachedDY = static_cast<int>(in.signedVarint()) * ballScale;
+    if (version >= 3) {
+        ai.cachedPoints = static_cast<int>(in.signedVarint());
+        ai.cachedWidth = static_cast<int>(in.signedVarint());
+        ai.cachedHeight = static_cast<int>(in.signedVarint());
+    } else {
+        ai.cachedPoints = state.player1Score + state.player2Score;
+        ai.cachedWidth = state.field_width;
+        ai.cachedHeight = state.field_height;
+    }
+    ai.target = static_cast<int>(in.signedVarint());
+    ai.aimOffset = static_cast<int>(in.signedVarint());
+    ai.reactionLeft = static_cast<int>(in.signedVarint());
+    return ai;
+}
+
+static bool sameState(const GameState& a, const GameState& b) {
+    std::string left, right;
+    encodeGameState(left, a);
+    encodeGameState(right, b);
+    return left == right;
+}
+
+static void putFloat(std::string& out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putVarint(out, bits);
+}
+
+static float readFloat(Reader& in) {
+    uint32_t bits = static_cast<uint32_t>(in.varint());
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void putString(std::string& out, const std::string& text) {
+    putVarint(out, text.size());
+    out += text;
+}
+
+ReplayRecorder::ReplayRecorder(MatchArena& arena) : data(arena), lastTick(0), finished(false) {}
+
+void ReplayRecorder::begin(const Config& config, int gameMode, int difficulty, uint64_t aiSeed) {
+    scratch.assign(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    putFloat(scratch, config.speed);
+    putSigned(scratch, config.max_score);
+    putSigned(scratch, config.field_width);
+    putSigned(scratch, config.field_height);
+    putSigned(scratch, config.paddle_height);
+    putString(scratch, config.name_Player1);
+    putString(scratch, config.name_Player2);
+    putVarint(scratch, gameMode);
+    putVarint(scratch, difficulty);
+    putVarint(scratch, aiSeed);
+    putFloat(scratch, config.ball_speed);
+    putFloat(scratch, config.ball_max_speed);
+    putSigned(scratch, config.ball_speedup);
+    putSigned(scratch, config.ball_spin);
+    data.assign(scratch.data(), scratch.size());
+    lastTick = 0;
+    finished = false;
+}
+
+void ReplayRecorder::putHeader(long long tick, int flags) {
+    putVarint(data, (static_cast<uint64_t>(tick - lastTick) << 2) | static_cast<uint64_t>(flags));
+    lastTick = tick;
+}
+
+void ReplayRecorder::record(const GameState& state, const Inputs& humanInputs, const ComputerAI& computer) {
+    if (finished) return;
+    if (state.tick % REPLAY_KEYFRAME_INTERVAL == 0) {
+        putHeader(state.tick, 0);
+        data.push_back(static_cast<char>(REPLAY_KEYFRAME));
+        scratch.clear();
+        encodeGameState(scratch, state);
+        putComputer(scratch, computer.save());
+        data.append(scratch.data(), scratch.size());
+    }
+    int flags = (humanInputs.player1 != 0 ? 1 : 0) | (humanInputs.player2 != 0 ? 2 : 0);
+    if (flags == 0) return;  // Тики без ввода не занимают места.
+    putHeader(state.tick, flags);
+    if (flags & 1) putSigned(data, humanInputs.player1);
+    if (flags & 2) putSigned(data, humanInputs.player2);
+}
+
+void ReplayRecorder::recordResize(const GameState& state, const Config& config) {
+    if (finished) return;
+    putHeader(state.tick, 0);
+    data.push_back(static_cast<char>(REPLAY_RESIZE));
+    putSigned(data, config.field_width);
+    putSigned(data, config.field_height);
+    putSigned(data, config.paddle_height);
+}
+
+void ReplayRecorder::finish(const GameState& state) {
+    if (finished) return;
+    putHeader(state.tick, 0);
+    data.push_back(static_cast<char>(REPLAY_END));
+    putSigned(data, state.player1Score);
+    putSigned(data, state.player2Score);
+    finished = true;
+}
+
+bool ReplayRecorder::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    data.forEachChunk([&](const char* chunk, size_t size) { file.write(chunk, static_cast<std::streamsize>(size)); });
+    return static_cast<bool>(file);
+}
+
+ReplayPlayer::ReplayPlayer()
+    : gameMode(MODE_VERSUS), difficulty(DIFFICULTY_NORMAL), aiSeed(0), totalTicks(0),
+      finalScore1(0), finalScore2(0), state(newGame(Config(), MODE_VERSUS)),
+      nextEvent(0), nextKeyframe(0), nextResize(0), desyncs(0) {}
+
+bool ReplayPlayer::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return parse(content);
+}
+
+// Ключевой кадр испорченного файла не должен давать физике мяч вне поля или скорость выше предела:
+// иначе переполнение в bounceOffPaddle. Поле — из заголовка или последней смены поля до кадра.
+static bool keyframeFits(const GameState& state, const Config& field, int mode, long long tick) {
+    auto paddleFits = [&](const Paddle& paddle) {
+        return paddle.getX() >= 0 && paddle.getX() < field.field_width && paddle.getHeight() >= 1 &&
+               paddle.getY() >= 0 && paddle.getY() <= field.field_height - paddle.getHeight();
+    };
+    const Ball& ball = state.ball;
+    int maxSpeed = state.physics.maxSpeed;
+    return state.mode == mode && state.tick == tick && state.field_width == field.field_width &&
+           state.field_height == field.field_height && state.max_score == field.max_score &&
+           paddleFits(state.player1) && paddleFits(state.player2) &&
+           ball.getFixedX() >= 0 && ball.getFixedX() < field.field_width * BALL_ONE &&
+           ball.getFixedY() >= 0 && ball.getFixedY() < field.field_height * BALL_ONE &&
+           ball.getDX() != 0 && ball.getDX() >= -maxSpeed && ball.getDX() <= maxSpeed &&
+           ball.getDY() >= -maxSpeed && ball.getDY() <= maxSpeed &&
+           state.player1Score >= 0 && state.player1Score <= field.max_score &&
+           state.player2Score >= 0 && state.player2Score <= field.max_score;
+}
+
+bool ReplayPlayer::parse(const std::string& content) {
+    if (content.size() < sizeof(REPLAY_MAGIC)) return false;
+    int version = memcmp(content.data(), REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) == 0 ? 3
+                : memcmp(content.data(), REPLAY_MAGIC_V2, sizeof(REPLAY_MAGIC_V2)) == 0 ? 2
+                : memcmp(content.data(), REPLAY_MAGIC_V1, sizeof(REPLAY_MAGIC_V1)) == 0 ? 1 : 0;
+    if (version == 0) return false;
+    bool legacy = version == 1;
+    Reader in(content.data() + sizeof(REPLAY_MAGIC), content.size() - sizeof(REPLAY_MAGIC));
+
+    config = Config();
+    config.speed = readFloat(in);
+    config.max_score = static_cast<int>(in.signedVarint());
+    config.field_width = static_cast<int>(in.signedVarint());
+    config.field_height = static_cast<int>(in.signedVarint());
+    config.paddle_height = static_cast<int>(in.signedVarint());
+    config.name_Player1 = in.bytes(in.varint());
+    config.name_Player2 = in.bytes(in.varint());
+    gameMode = static_cast<int>(in.varint());
+    difficulty = static_cast<int>(in.varint());
+    aiSeed = in.varint();
+    if (!legacy) {
+        config.ball_speed = readFloat(in);
+        config.ball_max_speed = readFloat(in);
+        config.ball_speedup = static_cast<int>(in.signedVarint());
+        config.ball_spin = static_cast<int>(in.signedVarint());
+    }
+    int ballScale = legacy ? BALL_ONE : 1;
+    if (!in.ok || difficulty < DIFFICULTY_EASY || difficulty > DIFFICULTY_PERFECT) return false;
+    if (gameMode < MODE_VERSUS || gameMode > MODE_WALL) return false;
+    config.ai_difficulty = difficulty;
+    // Настройки из файла проверяются так же, как присланные хостом сетевой партии.
+    std::string error;
+    if (!configInRange(config, error)) return false;
+
+    events.clear();
+    keyframes.clear();
+    resizes.clear();
+    long long tick = 0;
+    bool ended = false;
+    while (in.ok && !in.atEnd() && !ended) {
+        uint64_t header = in.varint();
+        tick += static_cast<long long>(header >> 2);
+        // Ключевой кадр пишется каждые REPLAY_KEYFRAME_INTERVAL тиков, пока идёт партия, поэтому
+        // ни одна запись не уходит дальше этого от последнего кадра: иначе повтор крутился бы почти бесконечно.
+        long long lastKeyframe = keyframes.empty() ? 0 : keyframes.back().state.tick;
+        if ((header >> 2) > static_cast<uint64_t>(REPLAY_KEYFRAME_INTERVAL) ||
+            tick > lastKeyframe + REPLAY_KEYFRAME_INTERVAL) {
+            return false;
+        }
+        int flags = static_cast<int>(header & 3);
+        if (flags != 0) {
+            Event event{tick, Inputs()};
+            if (flags & 1) event.inputs.player1 = static_cast<int>(in.signedVarint());
+            if (flags & 2) event.inputs.player2 = static_cast<int>(in.signedVarint());
+            events.push_back(event);
+            continue;
+        }
+        unsigned char kind = in.byte();
+        if (kind == REPLAY_KEYFRAME) {
+            Keyframe keyframe{newGame(config, gameMode), ComputerAIState(), events.size(), resizes.size()};
+            // physics в кадр не пишется: после смены поля её предел скорости — от нового поля, как у resizeGame.
+            if (!resizes.empty()) resizeGame(keyframe.state, resizedConfig(resizes.back()));
+            if (!decodeGameState(in, keyframe.state, ballScale)) break;
+            if (!keyframeFits(keyframe.state, resizes.empty() ? config : resizedConfig(resizes.back()), gameMode, tick)) {
+                return false;
+            }
+            keyframe.computer = readComputer(in, ballScale, version, keyframe.state);
+            keyframes.push_back(keyframe);
+        } else if (kind == REPLAY_RESIZE) {
+            Resize resize{tick, 0, 0, 0};
+            resize.field_width = static_cast<int>(in.signedVarint());
+            resize.field_height = static_cast<int>(in.signedVarint());
+            resize.paddle_height = static_cast<int>(in.signedVarint());
+            // Те же пределы, что у настроек: иначе испорченный файл даст поле, в котором нельзя играть.
+            if (!configInRange(resizedConfig(resize), error)) return false;
+            resizes.push_back(resize);
+        } else if (kind == REPLAY_END) {
+            totalTicks = tick;
+            finalScore1 = static_cast<int>(in.signedVarint());
+            finalScore2 = static_cast<int>(in.signedVarint());
+            ended = true;
+        } else {
+            return false;
+        }
+    }
+    if (!in.ok || !ended) return false;  // Оборванный повтор (например, игра упала до конца партии).
+    restart();
+    return true;
+}
+
+void ReplayPlayer::restart() {
+    state = newGame(config, gameMode);
+    computer = ComputerAI(static_cast<Difficulty>(difficulty), aiSeed);
+    nextEvent = 0;
+    nextKeyframe = 0;
+    nextResize = 0;
+    desyncs = 0;
+}
+
+Config ReplayPlayer::resizedConfig(const Resize& resize) const {
+    Config resized = config;
+    resized.field_width = resize.field_width;
+    resized.field_height = resize.field_height;
+    resized.paddle_height = resize.paddle_height;
+    return resized;
+}
+
+void ReplayPlayer::stepTick() {
+    if (done()) return;
+
+    // Смена поля записана перед ключевым кадром того же тика, в кадре уже новое поле.
+    while (nextResize < resizes.size() && resizes[nextResize].tick == state.tick) {
+        resizeGame(state, resizedConfig(resizes[nextResize++]));
+    }
+
+    // Ключевой кадр на этом тике: сверка пересчитанного состояния с записанным.
+    if (nextKeyframe < keyframes.size() && keyframes[nextKeyframe].state.tick == state.tick) {
+        if (!sameState(keyframes[nextKeyframe].state, state)) desyncs++;
+        nextKeyframe++;
+    }
+
+    Inputs inputs;
+    if (nextEvent < events.size() && events[nextEvent].tick == state.tick) {
+        inputs = events[nextEvent].inputs;
+        nextEvent++;
+    }
+    // Ход компьютера пересчитывается так же, как в gameLoop.
+    if (gameMode == MODE_COMPUTER) {
+        inputs.player2 += computer.move(state, state.player2);
+    }
+    step(state, inputs);
+}
+
+void ReplayPlayer::seek(long long tick) {
+    if (tick < 0) tick = 0;
+    if (tick > totalTicks) tick = totalTicks;
+
+    // Назад или через ключевой кадр — прыжок на ближайший кадр не позже tick, иначе просто досимуляция.
+    size_t best = keyframes.size();
+    for (size_t i = 0; i < keyframes.size() && keyframes[i].state.tick <= tick; i++) best = i;
+    bool found = best < keyframes.size();
+    if (tick < state.tick || (found && keyframes[best].state.tick > state.tick)) {
+        if (found) {
+            const Keyframe& keyframe = keyframes[best];
+            state = keyframe.state;
+            computer.restore(keyframe.computer);
+            nextEvent = keyframe.nextEvent;
+            nextResize = keyframe.nextResize;
+            nextKeyframe = best + 1;
+        } else {
+            restart();
+        }
+    }
+    while (state.tick < tick) stepTick();
+}
+
+bool ReplayPlayer::runToEnd() {
+    while (!done()) stepTick();
+    return matchesRecording();
+}
+
+bool ReplayPlayer::matchesRecording() const {
+    return desyncs == 0 && state.player1Score == finalScore1 && state.player2Score == finalScore2;
+}
+
+int checkReplays(const std::vector<std::string>& paths, int threads) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<int> status(paths.size(), 0);  // 0 совпал, 1 расхождение, 2 не прочитан.
+    std::vector<long long> ticks(paths.size(), 0);
+
+    Clock::time_point start = Clock::now();
+    runWorkStealing(threads, static_cast<int>(paths.size()), [&](int task, int) {
+        ReplayPlayer player;
+        if (!player.load(paths[task])) {
+            status[task] = 2;
+            return;
+        }
+        status[task] = player.runToEnd() ? 0 : 1;
+        ticks[task] = player.getTotalTicks();
+    });
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    int mismatched = 0, unreadable = 0;
+    long long totalTicks = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        totalTicks += ticks[i];
+        if (status[i] == 1) {
+            mismatched++;
+            printf("MISMATCH    %s\n", paths[i].c_str());
+        } else if (status[i] == 2) {
+            unreadable++;
+            printf("UNREADABLE  %s\n", paths[i].c_str());
+        }
+    }
+    printf("replays:     %zu (%d mismatched, %d unreadable)\n", paths.size(), mismatched, unreadable);
+    printf("ticks:       %lld\n", totalTicks);
+    printf("time:        %.3f s\n", seconds);
+    printf("ticks/sec:   %.0f\n", seconds > 0 ? totalTicks / seconds : 0.0);
+    return mismatched || unreadable ? 1 : 0;
+}
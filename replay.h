@@ -0,0 +1,122 @@
+#ifndef PONG_REPLAY_H
+#define PONG_REPLAY_H
+
+// Повторы партий: запись ввода игроков по тикам и детерминированное воспроизведение.
+//
+// Файл: "PONGRPL3", заголовок (Config, режим, сложность и сид компьютера), затем поток записей.
+// Каждая запись начинается с varint (разница тиков с прошлой записью << 2 | флаги):
+//   флаги 1 и 2 — за ним zigzag-varint ввода игрока 1 и/или игрока 2 на этом тике;
+//   флаги 0     — служебная запись, следующий байт: REPLAY_END (итоговый счёт),
+//                 REPLAY_KEYFRAME (полное состояние партии и компьютера для перемотки) или
+//                 REPLAY_RESIZE (новые ширина, высота поля и высота ракеток после перезагрузки настроек).
+// Ходы компьютера не пишутся: при воспроизведении ComputerAI пересчитывает их из того же сида,
+// поэтому изменения ИИ или физики видны как расхождение с записанными ключевыми кадрами и счётом.
+
+#include "ai.h"
+#include "arena.h"
+#include "codec.h"
+#include "game.h"
+
+#include <string>
+#include <vector>
+
+const long long REPLAY_KEYFRAME_INTERVAL = 600;  // Ключевой кадр каждые 600 тиков.
+
+// Полное состояние партии в компактном виде (используется в ключевых кадрах).
+// Мяч записывается в долях клетки; ballScale переводит старые записи в целых клетках.
+// Параметры полёта (GameState::physics) не записываются: они берутся из настроек.
+void encodeGameState(std::string& out, const GameState& state);
+bool decodeGameState(Reader& in, GameState& state, int ballScale = 1);
+
+// Запись повтора идёт в арену партии: на тике не выделяется память.
+class ReplayRecorder {
+private:
+    ArenaBytes data;
+    std::string scratch;  // Ключевой кадр перед копированием в data; ёмкость сохраняется между кадрами.
+    long long lastTick;  // Тик последней записи, от него считается разница.
+    bool finished;
+
+    void putHeader(long long tick, int flags);
+
+public:
+    explicit ReplayRecorder(MatchArena& arena);
+
+    void begin(const Config& config, int gameMode, int difficulty, uint64_t aiSeed);
+
+    // Вызывается перед step() на каждом тике: ввод людей (без хода компьютера) и, раз в
+    // REPLAY_KEYFRAME_INTERVAL тиков, ключевой кадр.
+    void record(const GameState& state, const Inputs& humanInputs, const ComputerAI& computer);
+
+    // Вызывается перед resizeGame() и перед record() того же тика.
+    void recordResize(const GameState& state, const Config& config);
+
+    void finish(const GameState& state);
+    bool save(const std::string& path) const;
+    size_t size() const { return data.size(); }
+};
+
+class ReplayPlayer {
+private:
+    struct Event {
+        long long tick;
+        Inputs inputs;
+    };
+    struct Resize {
+        long long tick;
+        int field_width, field_height, paddle_height;
+    };
+    struct Keyframe {
+        GameState state;
+        ComputerAIState computer;
+        size_t nextEvent;   // Первое событие с тиком не меньше тика кадра.
+        size_t nextResize;  // Первая смена поля после кадра.
+    };
+
+    Config config;
+    int gameMode;
+    int difficulty;
+    uint64_t aiSeed;
+    std::vector<Event> events;
+    std::vector<Keyframe> keyframes;
+    std::vector<Resize> resizes;
+    long long totalTicks;
+    int finalScore1, finalScore2;
+
+    GameState state;
+    ComputerAI computer;
+    size_t nextEvent;
+    size_t nextKeyframe;
+    size_t nextResize;
+    int desyncs;  // Ключевые кадры, с которыми не сошлось пересчитанное состояние.
+
+    void restart();
+    Config resizedConfig(const Resize& resize) const;  // Настройки партии с полем после смены resize.
+
+public:
+    ReplayPlayer();
+
+    bool load(const std::string& path);
+    bool parse(const std::string& data);
+
+    const Config& getConfig() const { return config; }
+    int getMode() const { return gameMode; }
+    const GameState& getState() const { return state; }
+    long long getTotalTicks() const { return totalTicks; }
+    int getDesyncs() const { return desyncs; }
+    bool done() const { return state.tick >= totalTicks; }
+
+    // Один тик вперёд.
+    void stepTick();
+
+    // Перемотка: ближайший ключевой кадр не позже tick и досимуляция до tick.
+    void seek(long long tick);
+
+    // Досимулировать до конца. true, если итог совпал с записанным и расхождений с кадрами нет.
+    bool runToEnd();
+    bool matchesRecording() const;
+};
+
+// Проверка пачки повторов на всех ядрах: пересимуляция и сверка со счётом. Отчёт в stdout.
+int checkReplays(const std::vector<std::string>& paths, int threads);
+
+#endif
@@ -0,0 +1,398 @@
+#include "scorelog.h"
+#include "game.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char SCORE_MAGIC[8] = {'P', 'O', 'N', 'G', 'S', 'C', 'R', '1'};
+static const char NAMES_MAGIC[8] = {'P', 'O', 'N', 'G', 'N', 'A', 'M', '1'};
+static const uint32_t SCORE_VERSION = 1;
+static const size_t MAX_NAME = 255;
+
+static uint32_t fnv1a(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t scoreRecordChecksum(const ScoreRecord& record) {
+    return fnv1a(&record, offsetof(ScoreRecord, checksum));
+}
+
+// Запись буфера целиком; write() может записать только часть.
+static bool writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) return false;
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+static std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+// Имена с позиции pos до конца буфера; возвращает конец последнего целого имени.
+static size_t parseNameRecords(const unsigned char* data, size_t pos, size_t size, std::vector<std::string>& names) {
+    while (pos + 2 <= size) {
+        uint16_t length;
+        memcpy(&length, data + pos, 2);
+        if (pos + 2 + length + 4 > size) break;  // Оборванное имя.
+        uint32_t checksum;
+        memcpy(&checksum, data + pos + 2 + length, 4);
+        if (checksum != fnv1a(data + pos + 2, length)) break;
+        names.emplace_back(reinterpret_cast<const char*>(data + pos + 2), length);
+        pos += 2 + length + 4;
+    }
+    return pos;
+}
+
+// Чтение таблицы имён из буфера; возвращает длину корректной части.
+static size_t parseNames(const unsigned char* data, size_t size, std::vector<std::string>& names) {
+    if (size < sizeof(NAMES_MAGIC) || memcmp(data, NAMES_MAGIC, sizeof(NAMES_MAGIC)) != 0) return 0;
+    return parseNameRecords(data, sizeof(NAMES_MAGIC), size, names);
+}
+
+// Исключительная блокировка файла имён, пока процесс дочитывает чужие имена и дописывает своё:
+// иначе два процесса могут оба не найти имя и дописать его под разными номерами.
+class NamesLock {
+private:
+    int fd;
+    bool locked;
+
+public:
+    explicit NamesLock(int fd) : fd(fd), locked(false) {
+        int result;
+        while ((result = flock(fd, LOCK_EX)) != 0 && errno == EINTR) {}
+        locked = result == 0;
+    }
+    ~NamesLock() {
+        if (locked) flock(fd, LOCK_UN);
+    }
+    NamesLock(const NamesLock&) = delete;
+    NamesLock& operator=(const NamesLock&) = delete;
+
+    bool isLocked() const { return locked; }
+};
+
+static bool readFile(const std::string& path, std::vector<unsigned char>& content) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool parseLegacyScoreLine(const std::string& line, ScoreEntry& entry) {
+    // "<имя1> - <счёт1> <имя2> - <счёт2>", имена могут быть с пробелами вокруг.
+    size_t dash1 = line.find(" - ");
+    if (dash1 == std::string::npos) return false;
+    size_t pos = dash1 + 3;
+    while (pos < line.size() && line[pos] == ' ') pos++;
+    size_t numberEnd = pos;
+    while (numberEnd < line.size() && isdigit(static_cast<unsigned char>(line[numberEnd]))) numberEnd++;
+    if (numberEnd == pos || numberEnd - pos > 9) return false;
+    size_t dash2 = line.rfind(" - ");
+    if (dash2 == std::string::npos || dash2 <= numberEnd) return false;
+    std::string score2 = trim(line.substr(dash2 + 3));
+    if (score2.empty() || score2.size() > 9 || score2.find_first_not_of("0123456789") != std::string::npos) return false;
+
+    entry.player1 = trim(line.substr(0, dash1));
+    entry.score1 = std::stoi(line.substr(pos, numberEnd - pos));
+    entry.player2 = trim(line.substr(numberEnd, dash2 - numberEnd));
+    entry.score2 = std::stoi(score2);
+    entry.mode = entry.player2 == "Computer" ? MODE_COMPUTER : MODE_VERSUS;
+    return !entry.player1.empty() && !entry.player2.empty();
+}
+
+ScoreLog::ScoreLog(const std::string& basePath)
+    : binPath(basePath + ".bin"), namesPath(basePath + ".names"), legacyPath(basePath + ".txt"), binFd(-1), namesFd(-1), namesSize(0) {}
+
+ScoreLog::~ScoreLog() {
+    close();
+}
+
+void ScoreLog::close() {
+    if (binFd >= 0) ::close(binFd);
+    if (namesFd >= 0) ::close(namesFd);
+    binFd = namesFd = -1;
+}
+
+bool ScoreLog::openNames() {
+    // O_APPEND: журнал открыт всё время работы игры, и другие процессы дописывают в те же файлы.
+    namesFd = ::open(namesPath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (namesFd < 0) {
+        error = "Unable to open " + namesPath;
+        return false;
+    }
+    NamesLock lock(namesFd);
+    if (!lock.isLocked()) {
+        error = "Unable to lock " + namesPath;
+        return false;
+    }
+
+    std::vector<unsigned char> content;
+    readFile(namesPath, content);
+    names.clear();
+    ids.clear();
+    size_t valid = parseNames(content.data(), content.size(), names);
+    for (uint32_t i = 0; i < names.size(); i++) ids[names[i]] = i;
+    // Чужой или испорченный с самого начала файл не перезаписывается: иначе записи журнала
+    // остались бы с номерами несуществующих имён.
+    if (valid == 0 && !content.empty()) {
+        error = namesPath + " is not a PONGNAM1 name table";
+        return false;
+    }
+    if (valid == 0) {
+        if (!writeAll(namesFd, NAMES_MAGIC, sizeof(NAMES_MAGIC))) return false;
+        valid = sizeof(NAMES_MAGIC);
+    } else if (valid < content.size() && ftruncate(namesFd, static_cast<off_t>(valid)) != 0) {
+        error = "Unable to cut the torn tail of " + namesPath;
+        return false;
+    }
+    namesSize = valid;
+    return true;
+}
+
+bool ScoreLog::syncNames() {
+    struct stat info;
+    if (namesFd < 0 || fstat(namesFd, &info) != 0 || static_cast<size_t>(info.st_size) <= namesSize) return false;
+    std::vector<unsigned char> tail(static_cast<size_t>(info.st_size) - namesSize);
+    if (pread(namesFd, tail.data(), tail.size(), static_cast<off_t>(namesSize)) != static_cast<ssize_t>(tail.size())) {
+        return false;
+    }
+    size_t first = names.size();
+    namesSize += parseNameRecords(tail.data(), 0, tail.size(), names);
+    for (uint32_t i = static_cast<uint32_t>(first); i < names.size(); i++) ids.emplace(names[i], i);
+    return names.size() > first;
+}
+
+bool ScoreLog::openRecords() {
+    binFd = ::open(binPath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (binFd < 0) {
+        error = "Unable to open " + binPath;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(binFd, &info) != 0) return false;
+    off_t size = info.st_size;
+    ScoreLogHeader header;
+    if (size == 0) {
+        // Заголовок пишется только в пустой файл; любой другой без своего заголовка — ошибка,
+        // а не повод стереть чужие или более новые результаты.
+        memcpy(header.magic, SCORE_MAGIC, sizeof(SCORE_MAGIC));
+        header.version = SCORE_VERSION;
+        header.recordSize = sizeof(ScoreRecord);
+        if (!writeAll(binFd, &header, sizeof(header))) return false;
+        size = sizeof(header);
+    } else if (size < static_cast<off_t>(sizeof(header))
+               || pread(binFd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+               || memcmp(header.magic, SCORE_MAGIC, sizeof(SCORE_MAGIC)) != 0) {
+        error = binPath + " is not a PONGSCR1 score log";
+        return false;
+    } else if (header.version != SCORE_VERSION || header.recordSize != sizeof(ScoreRecord)) {
+        error = binPath + " has unsupported version " + std::to_string(header.version) + " or record size " +
+                std::to_string(header.recordSize);
+        return false;
+    }
+
+    // Оборванная последняя запись отрезается, чтобы следующие шли по границе записей. Записи
+    // полной длины в конце тоже могут быть не дописаны (файл удлинён, данные не дошли до диска):
+    // хвост с неверной контрольной суммой отрезается до последней целой записи.
+    off_t records = (size - static_cast<off_t>(sizeof(header))) / static_cast<off_t>(sizeof(ScoreRecord));
+    ScoreRecord last;
+    while (records > 0) {
+        off_t offset = static_cast<off_t>(sizeof(header)) + (records - 1) * static_cast<off_t>(sizeof(ScoreRecord));
+        if (pread(binFd, &last, sizeof(last), offset) != static_cast<ssize_t>(sizeof(last))) return false;
+        if (last.checksum == scoreRecordChecksum(last)) break;
+        records--;
+    }
+    off_t valid = static_cast<off_t>(sizeof(header)) + records * static_cast<off_t>(sizeof(ScoreRecord));
+    if (valid < size && ftruncate(binFd, valid) != 0) {
+        error = "Unable to cut the torn tail of " + binPath;
+        return false;
+    }
+    return true;
+}
+
+bool ScoreLog::open() {
+    close();
+    error.clear();
+    struct stat info;
+    bool fresh = stat(binPath.c_str(), &info) != 0;
+    if (!openNames() || !openRecords()) {
+        close();
+        return false;
+    }
+    if (fresh) importLegacy(legacyPath);
+    return true;
+}
+
+bool ScoreLog::importLegacy(const std::string& textPath) {
+    std::ifstream file(textPath);
+    if (!file.is_open()) return false;
+    std::vector<ScoreEntry> entries;
+    std::string line;
+    ScoreEntry entry;
+    while (std::getline(file, line)) {
+        if (parseLegacyScoreLine(line, entry)) entries.push_back(entry);
+    }
+    return appendBatch(entries);
+}
+
+bool ScoreLog::intern(const std::string& rawName, uint32_t& id) {
+    std::string name = trim(rawName).substr(0, MAX_NAME);
+    auto found = ids.find(name);
+    if (found != ids.end()) {
+        id = found->second;
+        return true;
+    }
+    if (namesFd < 0) return false;
+
+    // Под блокировкой: дочитать имена других процессов, и если имени всё ещё нет — дописать его.
+    NamesLock lock(namesFd);
+    if (!lock.isLocked()) return false;
+    syncNames();
+    if ((found = ids.find(name)) != ids.end()) {
+        id = found->second;
+        return true;
+    }
+    // Хвост, который не разобрался (процесс упал посреди записи), отрезается: новое имя
+    // должно лечь сразу за последним целым, иначе читатели до него не дойдут.
+    struct stat info;
+    if (fstat(namesFd, &info) != 0) return false;
+    if (static_cast<size_t>(info.st_size) > namesSize && ftruncate(namesFd, static_cast<off_t>(namesSize)) != 0) {
+        return false;
+    }
+
+    // Имя: длина, байты и контрольная сумма одной записью.
+    std::string record(2, '\0');
+    uint16_t length = static_cast<uint16_t>(name.size());
+    memcpy(&record[0], &length, 2);
+    record += name;
+    uint32_t checksum = fnv1a(name.data(), name.size());
+    record.append(reinterpret_cast<const char*>(&checksum), 4);
+    // Имя должно оказаться на диске раньше записей, которые на него ссылаются: без этого номер не выдаётся.
+    if (!writeAll(namesFd, record.data(), record.size()) || fdatasync(namesFd) != 0 || fstat(namesFd, &info) != 0) {
+        return false;
+    }
+    namesSize = static_cast<size_t>(info.st_size);
+
+    id = static_cast<uint32_t>(names.size());
+    names.push_back(name);
+    ids[name] = id;
+    return true;
+}
+
+bool ScoreLog::fillRecord(const ScoreEntry& entry, ScoreRecord& record) {
+    memset(&record, 0, sizeof(record));
+    record.timestamp = entry.timestamp;
+    if (!intern(entry.player1, record.player1) || !intern(entry.player2, record.player2)) return false;
+    record.score1 = entry.score1;
+    record.score2 = entry.score2;
+    record.mode = static_cast<uint8_t>(entry.mode);
+    record.checksum = scoreRecordChecksum(record);
+    return true;
+}
+
+bool ScoreLog::append(const ScoreEntry& entry, ScoreRecord* written) {
+    if (binFd < 0) return false;
+    ScoreRecord record;
+    if (!fillRecord(entry, record)) return false;
+    if (!writeAll(binFd, &record, sizeof(record)) || fdatasync(binFd) != 0) return false;
+    if (written) *written = record;
+    return true;
+}
+
+bool ScoreLog::appendBatch(const std::vector<ScoreEntry>& entries) {
+    if (binFd < 0) return false;
+    if (entries.empty()) return true;
+
+    std::vector<ScoreRecord> records(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (!fillRecord(entries[i], records[i])) return false;
+    }
+    if (!writeAll(binFd, records.data(), records.size() * sizeof(ScoreRecord))) return false;
+    return fdatasync(binFd) == 0;
+}
+
+size_t ScoreLog::getCount() const {
+    struct stat info;
+    if (binFd < 0 || fstat(binFd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(ScoreLogHeader))) return 0;
+    return static_cast<size_t>(info.st_size - sizeof(ScoreLogHeader)) / sizeof(ScoreRecord);
+}
+
+ScoreLogReader::ScoreLogReader() : data(nullptr), size(0), count(0) {}
+
+ScoreLogReader::~ScoreLogReader() {
+    close();
+}
+
+void ScoreLogReader::close() {
+    if (data) munmap(const_cast<unsigned char*>(data), size);
+    data = nullptr;
+    size = count = 0;
+    names.clear();
+}
+
+bool ScoreLogReader::open(const std::string& basePath) {
+    close();
+
+    std::vector<unsigned char> content;
+    if (readFile(basePath + ".names", content)) parseNames(content.data(), content.size(), names);
+
+    int fd = ::open((basePath + ".bin").c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(ScoreLogHeader))) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // Отображение остаётся действительным и после закрытия дескриптора.
+    if (mapped == MAP_FAILED) return false;
+
+    data = static_cast<const unsigned char*>(mapped);
+    size = static_cast<size_t>(info.st_size);
+    const ScoreLogHeader* header = reinterpret_cast<const ScoreLogHeader*>(data);
+    if (memcmp(header->magic, SCORE_MAGIC, sizeof(SCORE_MAGIC)) != 0 || header->version != SCORE_VERSION ||
+        header->recordSize != sizeof(ScoreRecord)) {
+        close();
+        return false;
+    }
+    count = (size - sizeof(ScoreLogHeader)) / sizeof(ScoreRecord);
+    return true;
+}
+
+const ScoreRecord& ScoreLogReader::record(size_t i) const {
+    return reinterpret_cast<const ScoreRecord*>(data + sizeof(ScoreLogHeader))[i];
+}
+
+bool ScoreLogReader::valid(size_t i) const {
+    const ScoreRecord& r = record(i);
+    return r.checksum == scoreRecordChecksum(r) && r.player1 < names.size() && r.player2 < names.size();
+}
+
+const std::string& ScoreLogReader::name(uint32_t id) const {
+    static const std::string unknown = "?";
+    return id < names.size() ? names[id] : unknown;
+}
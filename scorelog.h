@@ -0,0 +1,127 @@
+#ifndef PONG_SCORELOG_H
+#define PONG_SCORELOG_H
+
+// Журнал результатов: двоичный файл фиксированных записей только на дозапись
+// плюс таблица имён игроков. Заменяет текстовый scores.txt.
+//
+// <base>.bin:   заголовок ScoreLogHeader, затем записи ScoreRecord по 32 байта.
+// <base>.txt:   старый текстовый формат, переносится в журнал при его создании.
+// <base>.names: заголовок "PONGNAM1", затем имена: uint16 длина, байты имени, uint32 контрольная сумма.
+//               Номер имени в файле — это идентификатор игрока в записях.
+//
+// Каждая запись дописывается одним write() и сбрасывается на диск. Имена дописываются под flock
+// на файл имён: процесс дочитывает чужие имена и только потом решает, нужно ли новое.
+// Оборванная при сбое запись в конце файла не проходит проверку длины или контрольной суммы
+// и отрезается при следующем открытии журнала на запись. Файл с чужим заголовком, другой версией
+// или размером записи не открывается и не перезаписывается.
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ScoreLogHeader {
+    char magic[8];        // "PONGSCR1"
+    uint32_t version;     // 1
+    uint32_t recordSize;  // sizeof(ScoreRecord)
+};
+
+struct ScoreRecord {
+    int64_t timestamp;    // Время окончания партии (секунды Unix), 0 — импорт из scores.txt.
+    uint32_t player1;     // Идентификатор имени игрока 1.
+    uint32_t player2;     // Идентификатор имени игрока 2.
+    int32_t score1;
+    int32_t score2;
+    uint8_t mode;         // MODE_VERSUS, MODE_COMPUTER, ...
+    uint8_t reserved[3];
+    uint32_t checksum;    // FNV-1a первых 28 байт.
+};
+
+static_assert(sizeof(ScoreRecord) == 32, "ScoreRecord must stay 32 bytes");
+
+// Результат одной партии для записи в журнал.
+struct ScoreEntry {
+    std::string player1;
+    int score1;
+    std::string player2;
+    int score2;
+    int mode;
+    int64_t timestamp = 0;  // 0 — время неизвестно (импорт из scores.txt).
+};
+
+// Запись в журнал. Может оставаться открытым всё время работы: записи и имена дописываются
+// в конец файлов (O_APPEND), а имена, добавленные другими процессами, дочитываются перед новым.
+class ScoreLog {
+private:
+    std::string binPath, namesPath, legacyPath;
+    int binFd, namesFd;
+    size_t namesSize;  // Сколько байт файла имён уже прочитано или записано этим журналом.
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::string error;
+
+    bool openNames();
+    bool openRecords();
+    bool syncNames();  // Дочитать имена, дописанные другими процессами; true, если они были.
+    bool fillRecord(const ScoreEntry& entry, ScoreRecord& record);
+    bool importLegacy(const std::string& textPath);
+
+public:
+    explicit ScoreLog(const std::string& basePath = "scores");
+    ~ScoreLog();
+    ScoreLog(const ScoreLog&) = delete;
+    ScoreLog& operator=(const ScoreLog&) = delete;
+
+    // Открытие (с созданием) журнала. Если журнала ещё нет, а рядом лежит <base>.txt (scores.txt),
+    // старые результаты один раз переносятся в журнал.
+    bool open();
+    void close();
+    bool isOpen() const { return binFd >= 0; }
+    const std::string& getError() const { return error; }  // Почему не открылся журнал, если известно.
+
+    // Идентификатор игрока; новое имя дописывается в таблицу имён под flock, чтобы у одного имени
+    // в разных процессах был один номер. false — имя не удалось записать на диск.
+    bool intern(const std::string& name, uint32_t& id);
+
+    // Дописать результаты одной записью на каждую партию, одним write() и одним fsync.
+    // written получает дописанную запись (для таблицы лидеров).
+    bool append(const ScoreEntry& entry, ScoreRecord* written = nullptr);
+    bool appendBatch(const std::vector<ScoreEntry>& entries);
+
+    // Сколько записей сейчас в журнале (по размеру файла, с учётом чужих дописываний).
+    size_t getCount() const;
+    const std::vector<std::string>& getNames() const { return names; }
+};
+
+// Чтение журнала через mmap: файл читается ОС по мере обращения к записям,
+// открытый читатель листается без повторного чтения файла.
+class ScoreLogReader {
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t count;
+    std::vector<std::string> names;
+
+public:
+    ScoreLogReader();
+    ~ScoreLogReader();
+    ScoreLogReader(const ScoreLogReader&) = delete;
+    ScoreLogReader& operator=(const ScoreLogReader&) = delete;
+
+    bool open(const std::string& basePath = "scores");
+    void close();
+
+    size_t getCount() const { return count; }
+    const ScoreRecord& record(size_t i) const;
+    bool valid(size_t i) const;  // Контрольная сумма записи сходится.
+    const std::string& name(uint32_t id) const;
+    const std::vector<std::string>& getNames() const { return names; }
+};
+
+// Контрольная сумма записи.
+uint32_t scoreRecordChecksum(const ScoreRecord& record);
+
+// Разбор строки старого scores.txt вида "name - 5 other - 4". false, если строка не разобрана.
+bool parseLegacyScoreLine(const std::string& line, ScoreEntry& entry);
+
+#endif
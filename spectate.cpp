@@ -0,0 +1,663 @@
+#include "spectate.h"
+#include "codec.h"
+#include "replay.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Типы кадров.
+enum SpectateFrame {
+    FRAME_KEY = 1,    // Имена игроков и полное состояние.
+    FRAME_DELTA = 2   // Разница с предыдущим тиком.
+};
+
+// Биты маски в кадре разницы: за каждым установленным битом (кроме FINISHED) следует разность со знаком.
+enum DeltaField {
+    DELTA_BALL_X = 1 << 0,
+    DELTA_BALL_Y = 1 << 1,
+    DELTA_PLAYER1 = 1 << 2,
+    DELTA_PLAYER2 = 1 << 3,
+    DELTA_SCORE1 = 1 << 4,
+    DELTA_SCORE2 = 1 << 5,
+    DELTA_FINISHED = 1 << 6  // Флаг окончания партии переключился.
+};
+
+static const size_t MAX_FRAME_SIZE = 4096;
+static const size_t MAX_NAME_SIZE = 64;  // Имя в ключевом кадре обрезается до стольких байт.
+
+static long long nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool parseSpectateAddress(const std::string& text, SpectateAddress& address) {
+    if (text.empty()) return false;
+    address = SpectateAddress();
+    size_t colon = text.rfind(':');
+    std::string port = colon == std::string::npos ? text : text.substr(colon + 1);
+    bool numeric = !port.empty() && port.find_first_not_of("0123456789") == std::string::npos;
+    if (!numeric || text.find('/') != std::string::npos) {
+        address.unixSocket = true;
+        address.path = text;
+        return address.path.size() < sizeof(sockaddr_un().sun_path);
+    }
+    address.host = colon == std::string::npos ? std::string() : text.substr(0, colon);
+    // Номер порта только из цифр, но может не влезть в int: strtol с проверкой диапазона, без исключений.
+    errno = 0;
+    char* end = nullptr;
+    long value = strtol(port.c_str(), &end, 10);
+    if (errno == ERANGE || *end != '\0' || value < 0 || value > 65535) return false;
+    address.port = static_cast<int>(value);
+    return true;
+}
+
+// Длина (varint) и содержимое кадра одним буфером: его и раздаём всем зрителям.
+static SharedFrame makeFrame(const std::string& payload) {
+    std::string frame;
+    frame.reserve(payload.size() + 2);
+    putVarint(frame, payload.size());
+    frame += payload;
+    return std::make_shared<const std::string>(std::move(frame));
+}
+
+static void putName(std::string& out, const std::string& name) {
+    size_t length = std::min(name.size(), MAX_NAME_SIZE);
+    putVarint(out, length);
+    out.append(name, 0, length);
+}
+
+// Имя из ключевого кадра; длиннее, чем пишет сервер, — испорченный кадр.
+static std::string readName(Reader& in) {
+    uint64_t length = in.varint();
+    if (length > MAX_NAME_SIZE) {
+        in.ok = false;
+        return std::string();
+    }
+    return in.bytes(static_cast<size_t>(length));
+}
+
+static SharedFrame encodeKeyframe(const Config& config, const GameState& state) {
+    std::string payload;
+    payload.push_back(static_cast<char>(FRAME_KEY));
+    putName(payload, config.name_Player1);
+    putName(payload, config.name_Player2);
+    encodeGameState(payload, state);
+    return makeFrame(payload);
+}
+
+static SharedFrame encodeDelta(const GameState& previous, const GameState& state) {
+    int fields[6] = {
+        state.ball.getX() - previous.ball.getX(),
+        state.ball.getY() - previous.ball.getY(),
+        state.player1.getY() - previous.player1.getY(),
+        state.player2.getY() - previous.player2.getY(),
+        state.player1Score - previous.player1Score,
+        state.player2Score - previous.player2Score,
+    };
+    int mask = state.finished != previous.finished ? DELTA_FINISHED : 0;
+    for (int i = 0; i < 6; i++) {
+        if (fields[i] != 0) mask |= 1 << i;
+    }
+
+    std::string payload;
+    payload.push_back(static_cast<char>(FRAME_DELTA));
+    putVarint(payload, static_cast<uint64_t>(state.tick - previous.tick));
+    payload.push_back(static_cast<char>(mask));
+    for (int i = 0; i < 6; i++) {
+        if (mask & (1 << i)) putSigned(payload, fields[i]);
+    }
+    return makeFrame(payload);
+}
+
+// Открывает слушающий (listening) или подключённый (!listening) сокет по адресу.
+static int openStream(const SpectateAddress& address, bool listening) {
+    if (address.unixSocket) {
+        sockaddr_un local;
+        memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        strncpy(local.sun_path, address.path.c_str(), sizeof(local.sun_path) - 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (listening) unlink(address.path.c_str());
+        int result = listening ? bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local))
+                               : ::connect(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+        if (result != 0 || (listening && ::listen(fd, SOMAXCONN) != 0)) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    addrinfo* result = nullptr;
+    std::string port = std::to_string(address.port);
+    const char* host = address.host.empty() ? (listening ? nullptr : "127.0.0.1") : address.host.c_str();
+    if (getaddrinfo(host, port.c_str(), &hints, &result) != 0 || !result) return -1;
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int ok = fd >= 0;
+    if (ok) {
+        int one = 1;
+        if (listening) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            ok = bind(fd, result->ai_addr, result->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0;
+        } else {
+            ok = ::connect(fd, result->ai_addr, result->ai_addrlen) == 0;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+    }
+    freeaddrinfo(result);
+    if (!ok) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool setNonBlocking(int fd) {
+    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0;
+}
+
+SpectatorServer::SpectatorServer()
+    : epollFd(-1), listenFd(-1), wakeFd(-1), running(false),
+      last(newGame(Config(), MODE_VERSUS)), haveState(false) {}
+
+SpectatorServer::~SpectatorServer() {
+    stop();
+}
+
+bool SpectatorServer::start(const SpectateAddress& address) {
+    if (running) return false;
+    listenFd = openStream(address, true);
+    if (listenFd < 0) return false;
+    if (address.unixSocket) unixPath = address.path;
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0 || !setNonBlocking(listenFd)) {
+        stop();
+        return false;
+    }
+
+    // Слушающий сокет и eventfd отличаются от зрителей указателем на свой дескриптор.
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.ptr = &wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    running = true;
+    thread = std::thread(&SpectatorServer::run, this);
+    return true;
+}
+
+void SpectatorServer::stop() {
+    if (running) {
+        running = false;
+        uint64_t one = 1;
+        if (write(wakeFd, &one, sizeof(one)) < 0) {}
+        thread.join();
+    }
+    for (Viewer* viewer : viewers) {
+        close(viewer->fd);
+        delete viewer;
+    }
+    viewers.clear();
+    counters.viewers = 0;
+    if (listenFd >= 0) close(listenFd);
+    if (wakeFd >= 0) close(wakeFd);
+    if (epollFd >= 0) close(epollFd);
+    listenFd = wakeFd = epollFd = -1;
+    if (!unixPath.empty()) unlink(unixPath.c_str());
+    unixPath.clear();
+}
+
+int SpectatorServer::getPort() const {
+    sockaddr_in address;
+    socklen_t length = sizeof(address);
+    if (listenFd < 0 || getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length) != 0) return -1;
+    return address.sin_family == AF_INET ? ntohs(address.sin_port) : -1;
+}
+
+void SpectatorServer::beginMatch(const Config& matchConfig, const GameState& state) {
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(Update{true, matchConfig, state});
+    }
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0) {}
+}
+
+void SpectatorServer::publish(const GameState& state) {
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(Update{false, Config(), state});
+    }
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0) {}
+}
+
+void SpectatorServer::run() {
+    epoll_event events[64];
+    std::vector<Update> updates;
+    std::vector<Viewer*> closed;
+
+    while (running) {
+        int count = epoll_wait(epollFd, events, 64, -1);
+        for (int i = 0; i < count; i++) {
+            void* tag = events[i].data.ptr;
+            if (tag == &listenFd) {
+                acceptViewers();
+            } else if (tag == &wakeFd) {
+                uint64_t value;
+                if (read(wakeFd, &value, sizeof(value)) < 0) {}
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    updates.swap(pending);
+                }
+                for (const Update& update : updates) process(update);
+                updates.clear();
+            } else {
+                Viewer* viewer = static_cast<Viewer*>(tag);
+                if (viewer->fd < 0) continue;  // Закрыт раньше в этой же пачке событий.
+                bool alive = !(events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP));
+                if (alive && (events[i].events & EPOLLIN)) {
+                    // Зрителю нечего присылать: всё прочитанное выбрасывается, 0 — отключился.
+                    char scratch[256];
+                    ssize_t size = recv(viewer->fd, scratch, sizeof(scratch), MSG_DONTWAIT);
+                    if (size == 0 || (size < 0 && errno != EAGAIN && errno != EINTR)) alive = false;
+                }
+                if (alive && (events[i].events & EPOLLOUT)) {
+                    viewer->writable = true;
+                    watchWrites(*viewer, false);
+                    flush(*viewer);
+                }
+                if (!alive) closeViewer(viewer);
+            }
+        }
+
+        // Удаление отложено до конца пачки: в ней могут быть события уже закрытых зрителей.
+        for (size_t i = 0; i < viewers.size();) {
+            if (viewers[i]->fd < 0) {
+                closed.push_back(viewers[i]);
+                viewers[i] = viewers.back();
+                viewers.pop_back();
+            } else {
+                i++;
+            }
+        }
+        for (Viewer* viewer : closed) delete viewer;
+        closed.clear();
+    }
+}
+
+void SpectatorServer::acceptViewers() {
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // На Unix-сокете просто не сработает.
+
+        Viewer* viewer = new Viewer{fd, std::deque<SharedFrame>(), 0, 0, true, true};
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.ptr = viewer;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        viewers.push_back(viewer);
+        counters.viewers++;
+
+        // Идёт партия — ключевой кадр сразу, не дожидаясь следующего тика.
+        if (haveState) {
+            enqueue(*viewer, encodeKeyframe(config, last));
+            viewer->needsKeyframe = false;
+            counters.keyframes++;
+            flush(*viewer);
+        }
+    }
+}
+
+// Один тик: кадр разницы кодируется один раз, ключевой — только если он кому-то нужен.
+void SpectatorServer::process(const Update& update) {
+    long long start = nowNs();
+    if (update.newMatch) {
+        config = update.config;
+        haveState = false;
+        for (Viewer* viewer : viewers) viewer->needsKeyframe = true;
+    }
+    SharedFrame delta;
+    SharedFrame keyframe;
+    if (haveState) delta = encodeDelta(last, update.state);
+    last = update.state;
+    haveState = true;
+    counters.ticks++;
+
+    for (Viewer* viewer : viewers) {
+        if (viewer->fd < 0) continue;
+        if (viewer->needsKeyframe) {
+            // Сначала должен уйти уже начатый кадр, иначе поток байт порвётся.
+            if (!viewer->queue.empty()) {
+                if (delta) counters.framesDropped++;
+                continue;
+            }
+            if (!keyframe) keyframe = encodeKeyframe(config, last);
+            enqueue(*viewer, keyframe);
+            viewer->needsKeyframe = false;
+            counters.keyframes++;
+        } else if (delta) {
+            if (viewer->queue.size() >= MAX_QUEUED_FRAMES || viewer->queuedBytes >= MAX_QUEUED_BYTES) {
+                // Зритель не успевает: выбрасываем всё, кроме начатого кадра, и ждём ключевого.
+                size_t keep = viewer->offset > 0 ? 1 : 0;
+                counters.framesDropped += static_cast<long long>(viewer->queue.size() - keep) + 1;
+                viewer->queue.resize(keep);
+                viewer->queuedBytes = keep ? viewer->queue.front()->size() : 0;
+                viewer->needsKeyframe = true;
+                continue;
+            }
+            enqueue(*viewer, delta);
+        }
+        if (viewer->writable) flush(*viewer);
+    }
+
+    long long spent = nowNs() - start;
+    counters.fanoutNs += spent;
+    if (spent > counters.maxFanoutNs) counters.maxFanoutNs = spent;
+}
+
+void SpectatorServer::enqueue(Viewer& viewer, const SharedFrame& frame) {
+    viewer.queue.push_back(frame);
+    viewer.queuedBytes += frame->size();
+    counters.framesQueued++;
+}
+
+// Отправка очереди одним sendmsg на несколько кадров. Сокет заполнен — ждём EPOLLOUT.
+void SpectatorServer::flush(Viewer& viewer) {
+    while (!viewer.queue.empty()) {
+        iovec parts[32];
+        int count = 0;
+        for (const SharedFrame& frame : viewer.queue) {
+            if (count == 32) break;
+            size_t skip = count == 0 ? viewer.offset : 0;
+            parts[count].iov_base = const_cast<char*>(frame->data()) + skip;
+            parts[count].iov_len = frame->size() - skip;
+            count++;
+        }
+        msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = parts;
+        message.msg_iovlen = count;
+        ssize_t sent = sendmsg(viewer.fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                viewer.writable = false;
+                watchWrites(viewer, true);
+            } else {
+                closeViewer(&viewer);
+            }
+            return;
+        }
+        counters.bytesSent += sent;
+
+        size_t left = static_cast<size_t>(sent);
+        while (left > 0) {
+            size_t rest = viewer.queue.front()->size() - viewer.offset;
+            if (left < rest) {
+                viewer.offset += left;
+                break;
+            }
+            left -= rest;
+            viewer.queuedBytes -= viewer.queue.front()->size();
+            viewer.queue.pop_front();
+            viewer.offset = 0;
+        }
+    }
+}
+
+void SpectatorServer::watchWrites(Viewer& viewer, bool enable) {
+    epoll_event event;
+    event.events = EPOLLIN | EPOLLRDHUP | (enable ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    event.data.ptr = &viewer;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, viewer.fd, &event);
+}
+
+void SpectatorServer::closeViewer(Viewer* viewer) {
+    if (viewer->fd < 0) return;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, viewer->fd, nullptr);
+    close(viewer->fd);
+    viewer->fd = -1;
+    viewer->queue.clear();
+    counters.viewers--;
+}
+
+SpectatorClient::SpectatorClient()
+    : fd(-1), config(), state(newGame(Config(), MODE_VERSUS)), haveState(false), frames(0), keyframes(0),
+      fieldChanged(false) {}
+
+SpectatorClient::~SpectatorClient() {
+    if (fd >= 0) close(fd);
+}
+
+bool SpectatorClient::connect(const SpectateAddress& address) {
+    fd = openStream(address, false);
+    return fd >= 0 && setNonBlocking(fd);
+}
+
+bool SpectatorClient::receive() {
+    bool open = true;
+    char chunk[65536];
+    for (;;) {
+        ssize_t size = read(fd, chunk, sizeof(chunk));
+        if (size > 0) {
+            buffer.append(chunk, static_cast<size_t>(size));
+            continue;
+        }
+        if (size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) open = false;
+        if (size < 0 && errno == EINTR) continue;
+        break;
+    }
+
+    size_t pos = 0;
+    while (pos < buffer.size()) {
+        Reader in(buffer.data() + pos, buffer.size() - pos);
+        uint64_t length = in.varint();
+        if (!in.ok) break;  // Длина ещё не пришла целиком.
+        if (length == 0 || length > MAX_FRAME_SIZE) return false;
+        size_t header = static_cast<size_t>(in.pos - reinterpret_cast<const unsigned char*>(buffer.data() + pos));
+        if (buffer.size() - pos - header < length) break;
+        if (!applyFrame(reinterpret_cast<const unsigned char*>(buffer.data() + pos + header), length)) return false;
+        pos += header + length;
+    }
+    buffer.erase(0, pos);
+    return open;
+}
+
+bool SpectatorClient::applyFrame(const unsigned char* data, size_t size) {
+    Reader in(data + 1, size - 1);
+    frames++;
+    if (data[0] == FRAME_KEY) {
+        config.name_Player1 = readName(in);
+        config.name_Player2 = readName(in);
+        if (!in.ok || !decodeGameState(in, state)) return false;
+        config.field_width = state.field_width;
+        config.field_height = state.field_height;
+        config.max_score = state.max_score;
+        config.paddle_height = state.player1.getHeight();
+        haveState = true;
+        fieldChanged = true;
+        keyframes++;
+        return in.ok;
+    }
+    if (data[0] != FRAME_DELTA) return false;
+    if (!haveState) return true;  // Разница без ключевого кадра бесполезна.
+
+    state.tick += static_cast<long long>(in.varint());
+    int mask = in.byte();
+    if (mask & DELTA_BALL_X) state.ball.setX(state.ball.getX() + static_cast<int>(in.signedVarint()));
+    if (mask & DELTA_BALL_Y) state.ball.setY(state.ball.getY() + static_cast<int>(in.signedVarint()));
+    if (mask & DELTA_PLAYER1) state.player1.setY(state.player1.getY() + static_cast<int>(in.signedVarint()));
+    if (mask & DELTA_PLAYER2) state.player2.setY(state.player2.getY() + static_cast<int>(in.signedVarint()));
+    if (mask & DELTA_SCORE1) state.player1Score += static_cast<int>(in.signedVarint());
+    if (mask & DELTA_SCORE2) state.player2Score += static_cast<int>(in.signedVarint());
+    if (mask & DELTA_FINISHED) state.finished = !state.finished;
+    return in.ok;
+}
+
+// Совпадает ли то, что видит зритель, с состоянием сервера.
+static bool sameView(const GameState& a, const GameState& b) {
+    return a.tick == b.tick && a.ball.getX() == b.ball.getX() && a.ball.getY() == b.ball.getY() &&
+           a.player1.getY() == b.player1.getY() && a.player2.getY() == b.player2.getY() &&
+           a.player1Score == b.player1Score && a.player2Score == b.player2Score && a.finished == b.finished;
+}
+
+// Зрители нагрузочного теста: все в одном потоке на своём epoll.
+struct LoadTestViewers {
+    int epollFd;
+    std::vector<std::unique_ptr<SpectatorClient>> clients;
+    std::mutex mutex;  // Держится, пока поток зрителей разбирает пачку событий.
+    std::atomic<bool> running{true};
+    std::atomic<long long> disconnected{0};
+
+    void run() {
+        epoll_event events[256];
+        while (running) {
+            int count = epoll_wait(epollFd, events, 256, 20);
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int i = 0; i < count; i++) {
+                SpectatorClient* client = static_cast<SpectatorClient*>(events[i].data.ptr);
+                if (!client->receive()) {
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, client->getFd(), nullptr);
+                    disconnected++;
+                }
+            }
+        }
+    }
+};
+
+// Бот нагрузочного теста: догоняет мяч и иногда пропускает ход.
+static int loadTestMove(const GameState& state, const Paddle& paddle, Rng& rng) {
+    if (rng.range(4) == 0) return 0;
+    return computerMove(state, paddle);
+}
+
+int runSpectateLoadTest(const Config& config, int maxViewers, int ticksPerStep, int tickRate) {
+    SpectatorServer server;
+    SpectateAddress address;
+    address.host = "127.0.0.1";
+    address.port = 0;
+    if (!server.start(address)) {
+        fprintf(stderr, "Cannot start spectator server\n");
+        return 1;
+    }
+    address.port = server.getPort();
+
+    LoadTestViewers viewers;
+    viewers.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    std::thread viewerThread(&LoadTestViewers::run, &viewers);
+
+    std::vector<int> steps;
+    for (int count : {1, 10, 50, 100, 250, 500, 1000, 2000, 5000}) {
+        if (count < maxViewers) steps.push_back(count);
+    }
+    steps.push_back(maxViewers);
+
+    printf("Spectator load test: %d ticks per step at %d Hz over TCP localhost\n", ticksPerStep, tickRate);
+    printf("%8s %12s %12s %10s %10s %10s %8s %10s\n", "viewers", "fanout us", "max us", "delivered", "dropped",
+           "keyframes", "in sync", "bytes/s");
+
+    Rng rng(1);
+    GameState state = newGame(config, MODE_COMPUTER);
+    server.beginMatch(config, state);
+    const std::chrono::nanoseconds tickStep(1000000000LL / std::max(tickRate, 1));
+    int sustained = 0;
+    int result = 0;
+
+    for (int target : steps) {
+        while (static_cast<int>(viewers.clients.size()) < target) {
+            std::unique_ptr<SpectatorClient> client(new SpectatorClient());
+            if (!client->connect(address)) {
+                fprintf(stderr, "Cannot connect viewer %zu (raise ulimit -n?)\n", viewers.clients.size() + 1);
+                result = 1;
+                break;
+            }
+            epoll_event event;
+            event.events = EPOLLIN;
+            event.data.ptr = client.get();
+            epoll_ctl(viewers.epollFd, EPOLL_CTL_ADD, client->getFd(), &event);
+            std::lock_guard<std::mutex> lock(viewers.mutex);
+            viewers.clients.push_back(std::move(client));
+        }
+        if (result) break;
+        int viewerCount = static_cast<int>(viewers.clients.size());
+        // Пока сервер не примет всех, новые зрители не получают кадров.
+        while (server.counters.viewers < viewerCount) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        long long ticks0 = server.counters.ticks, queued0 = server.counters.framesQueued;
+        long long dropped0 = server.counters.framesDropped, keyframes0 = server.counters.keyframes;
+        long long fanout0 = server.counters.fanoutNs, bytes0 = server.counters.bytesSent;
+        server.counters.maxFanoutNs = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        auto next = start;
+        for (int tick = 0; tick < ticksPerStep; tick++) {
+            Inputs inputs;
+            inputs.player1 = loadTestMove(state, state.player1, rng);
+            inputs.player2 = loadTestMove(state, state.player2, rng);
+            step(state, inputs);
+            server.publish(state);
+            if (state.finished) {
+                state = newGame(config, MODE_COMPUTER);
+                server.beginMatch(config, state);
+            }
+            next += tickStep;
+            std::this_thread::sleep_until(next);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));  // Дать зрителям дочитать.
+
+        long long ticks = server.counters.ticks - ticks0;
+        long long queued = server.counters.framesQueued - queued0;
+        long long dropped = server.counters.framesDropped - dropped0;
+        int inSync = 0;
+        {
+            std::lock_guard<std::mutex> lock(viewers.mutex);
+            for (const auto& client : viewers.clients) {
+                if (client->hasState() && sameView(client->getState(), state)) inSync++;
+            }
+        }
+        double delivered = 100.0 * queued / std::max(1LL, ticks * viewerCount);
+        double fanoutUs = (server.counters.fanoutNs - fanout0) / 1e3 / std::max(1LL, ticks);
+        printf("%8d %12.1f %12.1f %9.1f%% %10lld %10lld %8d %10.0f\n", viewerCount, fanoutUs,
+               server.counters.maxFanoutNs / 1e3, std::min(delivered, 100.0), dropped,
+               server.counters.keyframes - keyframes0, inSync, (server.counters.bytesSent - bytes0) / seconds);
+        fflush(stdout);
+        if (delivered >= 99.0 && inSync == viewerCount && fanoutUs * 1e3 < tickStep.count()) sustained = viewerCount;
+    }
+
+    viewers.running = false;
+    viewerThread.join();
+    server.stop();
+    close(viewers.epollFd);
+    printf("Sustained at %d Hz without dropped frames: %d viewers\n", tickRate, sustained);
+    return result;
+}
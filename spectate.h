@@ -0,0 +1,155 @@
+#ifndef PONG_SPECTATE_H
+#define PONG_SPECTATE_H
+
+// Трансляция партий зрителям по TCP или Unix-сокету.
+//
+// Игровой цикл отдаёт серверу состояние после каждого тика. Поток сервера кодирует по нему
+// один кадр (разница с предыдущим тиком: мяч, ракетки, счёт) и ставит этот же буфер в очередь
+// каждому зрителю — кадр не копируется. Новому зрителю и зрителю, который не успевал читать
+// и у которого выброшены промежуточные кадры, сначала уходит полный ключевой кадр.
+//
+// Поток байт: кадры подряд, перед каждым длина (varint). Первый байт кадра — тип.
+
+#include "game.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::shared_ptr<const std::string> SharedFrame;
+
+// Адрес вида "порт", "хост:порт" (TCP) или путь к Unix-сокету (всё остальное).
+struct SpectateAddress {
+    bool unixSocket = false;
+    std::string host;
+    int port = 0;
+    std::string path;
+};
+bool parseSpectateAddress(const std::string& text, SpectateAddress& address);
+
+// Счётчики сервера; читаются из любого потока.
+struct SpectatorCounters {
+    std::atomic<long long> viewers{0};
+    std::atomic<long long> ticks{0};           // Опубликовано состояний.
+    std::atomic<long long> framesQueued{0};    // Кадров поставлено в очереди зрителей.
+    std::atomic<long long> framesDropped{0};   // Выброшено у медленных зрителей.
+    std::atomic<long long> keyframes{0};       // Ключевых кадров поставлено в очереди.
+    std::atomic<long long> bytesSent{0};
+    std::atomic<long long> fanoutNs{0};        // Время раздачи кадров в потоке сервера.
+    std::atomic<long long> maxFanoutNs{0};     // Самая долгая раздача одного тика.
+};
+
+class SpectatorServer {
+public:
+    static const int MAX_QUEUED_FRAMES = 16;        // Больше в очереди — зритель не успевает.
+    static const size_t MAX_QUEUED_BYTES = 64 * 1024;
+
+private:
+    struct Viewer {
+        int fd;
+        std::deque<SharedFrame> queue;
+        size_t offset;         // Сколько байт первого кадра очереди уже отправлено.
+        size_t queuedBytes;
+        bool needsKeyframe;
+        bool writable;         // Ждём EPOLLOUT или можно писать сразу.
+    };
+
+    // Что игровой цикл передал потоку сервера.
+    struct Update {
+        bool newMatch;
+        Config config;
+        GameState state;
+    };
+
+    int epollFd;
+    int listenFd;
+    int wakeFd;
+    std::string unixPath;
+    std::thread thread;
+    std::atomic<bool> running;
+
+    std::mutex mutex;
+    std::vector<Update> pending;
+
+    // Дальше — только поток сервера.
+    std::vector<Viewer*> viewers;
+    Config config;
+    GameState last;
+    bool haveState;
+
+    void run();
+    void acceptViewers();
+    void process(const Update& update);
+    void enqueue(Viewer& viewer, const SharedFrame& frame);
+    void flush(Viewer& viewer);
+    void closeViewer(Viewer* viewer);
+    void watchWrites(Viewer& viewer, bool enable);
+
+public:
+    SpectatorCounters counters;
+
+    SpectatorServer();
+    ~SpectatorServer();
+    SpectatorServer(const SpectatorServer&) = delete;
+    SpectatorServer& operator=(const SpectatorServer&) = delete;
+
+    // Открывает сокет и запускает поток с циклом epoll.
+    bool start(const SpectateAddress& address);
+    void stop();
+    bool isRunning() const { return running; }
+    // Порт TCP-сокета (полезно, если открывали на порту 0).
+    int getPort() const;
+
+    // Вызываются из игрового цикла: начало партии и состояние после каждого тика.
+    void beginMatch(const Config& matchConfig, const GameState& state);
+    void publish(const GameState& state);
+};
+
+// Клиент зрителя: читает поток кадров и восстанавливает по нему состояние для отрисовки.
+class SpectatorClient {
+private:
+    int fd;
+    std::string buffer;
+    Config config;
+    GameState state;
+    bool haveState;
+    long long frames;
+    long long keyframes;
+    bool fieldChanged;
+
+    bool applyFrame(const unsigned char* data, size_t size);
+
+public:
+    SpectatorClient();
+    ~SpectatorClient();
+    SpectatorClient(const SpectatorClient&) = delete;
+    SpectatorClient& operator=(const SpectatorClient&) = delete;
+
+    bool connect(const SpectateAddress& address);
+    int getFd() const { return fd; }
+    // Читает всё, что пришло, и применяет кадры. false — соединение закрыто или поток испорчен.
+    bool receive();
+
+    bool hasState() const { return haveState; }
+    const GameState& getState() const { return state; }
+    const Config& getConfig() const { return config; }
+    long long getFrames() const { return frames; }
+    long long getKeyframes() const { return keyframes; }
+    // С прошлого вызова пришёл ключевой кадр (могли смениться поле и имена).
+    bool takeFieldChanged() {
+        bool changed = fieldChanged;
+        fieldChanged = false;
+        return changed;
+    }
+};
+
+// Нагрузочный тест: сервер, бот-партия с частотой tickRate и растущее до maxViewers число зрителей
+// в отдельном потоке. Для каждого числа зрителей — время раздачи тика, доставка и выброшенные кадры.
+int runSpectateLoadTest(const Config& config, int maxViewers, int ticksPerStep, int tickRate);
+
+#endif
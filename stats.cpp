@@ -0,0 +1,265 @@
+#include "stats.h"
+#include "game.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static const char STATS_MAGIC[8] = {'P', 'O', 'N', 'G', 'S', 'T', 'A', '1'};
+static const double START_RATING = 1500.0;
+static const double RATING_K = 32.0;  // Шаг рейтинга Эло за партию.
+
+Leaderboard::Leaderboard() : applied(0) {}
+
+PlayerStats& Leaderboard::player(uint32_t id) {
+    if (id >= players.size()) {
+        PlayerStats fresh = {0, 0, 0, 0, 0, 0, START_RATING};
+        players.resize(id + 1, fresh);
+    }
+    return players[id];
+}
+
+void Leaderboard::apply(const ScoreRecord& record) {
+    applied++;
+    if (record.player1 == record.player2) return;  // Игра с самим собой в рейтинг не идёт.
+    player(std::max(record.player1, record.player2));  // Рост массива до взятия ссылок.
+    PlayerStats& a = player(record.player1);
+    PlayerStats& b = player(record.player2);
+
+    a.matches++;
+    b.matches++;
+    a.pointsFor += record.score1;
+    a.pointsAgainst += record.score2;
+    b.pointsFor += record.score2;
+    b.pointsAgainst += record.score1;
+
+    double result;  // Очки игрока 1: 1 победа, 0.5 ничья, 0 поражение.
+    if (record.score1 > record.score2) {
+        a.wins++;
+        b.losses++;
+        result = 1.0;
+    } else if (record.score1 < record.score2) {
+        a.losses++;
+        b.wins++;
+        result = 0.0;
+    } else {
+        a.draws++;
+        b.draws++;
+        result = 0.5;
+    }
+
+    double expected = 1.0 / (1.0 + std::pow(10.0, (b.rating - a.rating) / 400.0));
+    double delta = RATING_K * (result - expected);
+    a.rating += delta;
+    b.rating -= delta;
+}
+
+bool Leaderboard::catchUp(const ScoreLogReader& reader) {
+    if (reader.getCount() < applied) return false;
+    for (size_t i = applied; i < reader.getCount(); i++) {
+        if (reader.valid(i)) apply(reader.record(i));
+        else applied++;  // Испорченная запись учитывается как просмотренная.
+    }
+    return true;
+}
+
+void Leaderboard::rebuild(const ScoreLogReader& reader) {
+    players.clear();
+    applied = 0;
+    catchUp(reader);
+}
+
+bool Leaderboard::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    char magic[8];
+    uint64_t count = 0, loadedApplied = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&loadedApplied), sizeof(loadedApplied));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!file || memcmp(magic, STATS_MAGIC, sizeof(magic)) != 0) return false;
+
+    // Число игроков из файла не верится на слово: повреждённый снимок должен ровно совпасть
+    // по размеру с остатком файла, иначе он отбрасывается и таблица пересчитывается по журналу.
+    std::streamoff header = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff left = file.tellg() - header;
+    file.seekg(header);
+    if (!file || left < 0 || count != static_cast<uint64_t>(left) / sizeof(PlayerStats) ||
+        static_cast<uint64_t>(left) % sizeof(PlayerStats) != 0) {
+        return false;
+    }
+
+    std::vector<PlayerStats> loaded(count);
+    file.read(reinterpret_cast<char*>(loaded.data()), static_cast<std::streamsize>(count * sizeof(PlayerStats)));
+    if (!file) return false;
+    players.swap(loaded);
+    applied = loadedApplied;
+    return true;
+}
+
+bool Leaderboard::save(const std::string& path) const {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+        uint64_t count = players.size();
+        file.write(STATS_MAGIC, sizeof(STATS_MAGIC));
+        file.write(reinterpret_cast<const char*>(&applied), sizeof(applied));
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        file.write(reinterpret_cast<const char*>(players.data()), static_cast<std::streamsize>(count * sizeof(PlayerStats)));
+        if (!file) return false;
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+std::vector<uint32_t> Leaderboard::top(size_t k) const {
+    std::vector<uint32_t> ids;
+    for (uint32_t id = 0; id < players.size(); id++) {
+        if (players[id].matches > 0) ids.push_back(id);
+    }
+    k = std::min(k, ids.size());
+    // Частичная сортировка: O(n log k) вместо сортировки всех игроков.
+    std::partial_sort(ids.begin(), ids.begin() + k, ids.end(), [this](uint32_t a, uint32_t b) {
+        if (players[a].rating != players[b].rating) return players[a].rating > players[b].rating;
+        return a < b;
+    });
+    ids.resize(k);
+    return ids;
+}
+
+const PlayerStats* Leaderboard::find(uint32_t id) const {
+    if (id >= players.size() || players[id].matches == 0) return nullptr;
+    return &players[id];
+}
+
+bool openLeaderboard(Leaderboard& board, ScoreLogReader& reader, const std::string& basePath) {
+    if (!reader.open(basePath)) return false;
+    std::string snapshot = basePath + ".stats";
+    // Нет снимка или журнал пересоздан (он короче снимка): пересчёт с нуля.
+    bool loaded = board.load(snapshot);
+    uint64_t before = board.getApplied();
+    if (!loaded || !board.catchUp(reader)) {
+        board = Leaderboard();
+        board.rebuild(reader);
+        board.save(snapshot);
+    } else if (board.getApplied() != before) {
+        board.save(snapshot);  // Снимок догнал журнал.
+    }
+    return true;
+}
+
+int rebuildLeaderboard(const std::string& basePath) {
+    using Clock = std::chrono::steady_clock;
+    ScoreLogReader reader;
+    if (!reader.open(basePath)) {
+        fprintf(stderr, "Error: Unable to open %s.bin\n", basePath.c_str());
+        return 1;
+    }
+    Leaderboard board;
+    Clock::time_point start = Clock::now();
+    board.rebuild(reader);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (!board.save(basePath + ".stats")) {
+        fprintf(stderr, "Error: Unable to write %s.stats\n", basePath.c_str());
+        return 1;
+    }
+
+    printf("records:  %llu\n", static_cast<unsigned long long>(board.getApplied()));
+    printf("players:  %zu\n", board.getPlayerCount());
+    printf("rebuild:  %.3f s\n", seconds);
+    printf("\n%4s  %-20s %6s %6s %6s %8s %8s %8s\n", "#", "name", "wins", "losses", "draws", "for", "against", "rating");
+    std::vector<uint32_t> best = board.top(10);
+    for (size_t i = 0; i < best.size(); i++) {
+        const PlayerStats& p = *board.find(best[i]);
+        printf("%4zu  %-20s %6u %6u %6u %8llu %8llu %8.1f\n", i + 1, reader.name(best[i]).c_str(), p.wins, p.losses,
+               p.draws, static_cast<unsigned long long>(p.pointsFor), static_cast<unsigned long long>(p.pointsAgainst), p.rating);
+    }
+    return 0;
+}
+
+int runStatsBenchmark(long long matches) {
+    using Clock = std::chrono::steady_clock;
+    const std::string base = "bench-stats";
+    const int playerCount = 1000;
+    const long long chunk = 1 << 20;
+
+    // Синтетическая история: журнал на диске, как у настоящего, со случайными парами и счётом.
+    std::remove((base + ".bin").c_str());
+    std::remove((base + ".names").c_str());
+    std::remove((base + ".stats").c_str());
+    Clock::time_point start = Clock::now();
+    {
+        ScoreLog log(base);
+        if (!log.open()) {
+            fprintf(stderr, "Error: Unable to create %s.bin\n", base.c_str());
+            return 1;
+        }
+        std::vector<std::string> names;
+        char name[32];
+        for (int i = 0; i < playerCount; i++) {
+            snprintf(name, sizeof(name), "player%04d", i);
+            names.push_back(name);
+            uint32_t id;
+            if (!log.intern(name, id)) {
+                fprintf(stderr, "Error: Unable to write %s.names\n", base.c_str());
+                return 1;
+            }
+        }
+        Rng rng(1);
+        std::vector<ScoreEntry> entries;
+        for (long long done = 0; done < matches; done += chunk) {
+            entries.clear();
+            for (long long i = done; i < std::min(done + chunk, matches); i++) {
+                int a = rng.range(playerCount), b = (a + 1 + rng.range(playerCount - 1)) % playerCount;
+                bool aWins = rng.range(2) == 0;
+                entries.push_back(ScoreEntry{names[a], aWins ? 20 : rng.range(20), names[b], aWins ? rng.range(20) : 20,
+                                             MODE_VERSUS, 1700000000 + i});
+            }
+            log.appendBatch(entries);
+        }
+    }
+    double generateSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    ScoreLogReader reader;
+    reader.open(base);
+    Leaderboard board;
+    start = Clock::now();
+    board.rebuild(reader);
+    double rebuildSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    board.save(base + ".stats");
+
+    // Одна новая партия: открытие снимка и догон журнала против полного пересчёта.
+    start = Clock::now();
+    const int queries = 1000;
+    volatile size_t sink = 0;
+    for (int i = 0; i < queries; i++) sink = sink + board.top(10).size();
+    double topSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    {
+        ScoreLog log(base);
+        log.open();
+        log.append(ScoreEntry{"player0000", 20, "player0001", 3, MODE_VERSUS, 1800000000});
+    }
+    start = Clock::now();
+    Leaderboard incremental;
+    ScoreLogReader incrementalReader;
+    openLeaderboard(incremental, incrementalReader, base);
+    double incrementalSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf("matches:            %lld (%d players)\n", matches, playerCount);
+    printf("generate log:       %.3f s\n", generateSeconds);
+    printf("full rebuild:       %.3f s (%.0f records/s)\n", rebuildSeconds,
+           rebuildSeconds > 0 ? matches / rebuildSeconds : 0.0);
+    printf("snapshot + 1 match: %.3f ms\n", incrementalSeconds * 1e3);
+    printf("top-10 query:       %.2f us\n", topSeconds * 1e6 / queries);
+    printf("applied:            %llu\n", static_cast<unsigned long long>(incremental.getApplied()));
+
+    std::remove((base + ".bin").c_str());
+    std::remove((base + ".names").c_str());
+    std::remove((base + ".stats").c_str());
+    return 0;
+}
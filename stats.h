@@ -0,0 +1,68 @@
+#ifndef PONG_STATS_H
+#define PONG_STATS_H
+
+// Таблица лидеров: накопительная статистика по игрокам журнала результатов.
+// Каждая новая партия применяется за O(1), итог хранится снимком <base>.stats
+// вместе с числом уже учтённых записей журнала. При открытии подгружается снимок
+// и дочитываются только записи, появившиеся после него, — полная история не пересчитывается.
+
+#include "scorelog.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct PlayerStats {
+    uint32_t matches;
+    uint32_t wins;
+    uint32_t losses;
+    uint32_t draws;
+    uint64_t pointsFor;
+    uint64_t pointsAgainst;
+    double rating;          // Рейтинг Эло, у нового игрока 1500.
+};
+
+class Leaderboard {
+private:
+    std::vector<PlayerStats> players;  // По идентификатору имени из журнала.
+    uint64_t applied;                  // Сколько записей журнала уже учтено.
+
+    PlayerStats& player(uint32_t id);
+
+public:
+    Leaderboard();
+
+    // Учёт одной партии: O(1).
+    void apply(const ScoreRecord& record);
+
+    // Дочитать записи журнала, которых ещё нет в статистике. false, если журнал короче снимка.
+    bool catchUp(const ScoreLogReader& reader);
+
+    // Пересчёт с нуля по всему журналу.
+    void rebuild(const ScoreLogReader& reader);
+
+    // Снимок: запись во временный файл и переименование, чтобы сбой не оставил половину снимка.
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    // Идентификаторы k лучших игроков по рейтингу.
+    std::vector<uint32_t> top(size_t k) const;
+
+    // Статистика игрока или nullptr, если он ещё не играл.
+    const PlayerStats* find(uint32_t id) const;
+
+    uint64_t getApplied() const { return applied; }
+    size_t getPlayerCount() const { return players.size(); }
+};
+
+// Открыть таблицу лидеров для журнала basePath: снимок плюс новые записи журнала.
+// Если снимок устарел, он сохраняется заново. reader остаётся открытым для имён.
+bool openLeaderboard(Leaderboard& board, ScoreLogReader& reader, const std::string& basePath = "scores");
+
+// Пересчитать статистику по всему журналу и сохранить снимок. Отчёт в stdout.
+int rebuildLeaderboard(const std::string& basePath = "scores");
+
+// Бенчмарк пересчёта по синтетической истории из matches партий. Отчёт в stdout.
+int runStatsBenchmark(long long matches);
+
+#endif
@@ -0,0 +1,566 @@
+#include "tournament.h"
+#include "pool.h"
+#include "scorelog.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Партия турнира. player2 == -1 — соперника нет (проход в следующий круг на выбывание).
+struct TournamentMatch {
+    int id;
+    int round;
+    int player1;
+    int player2;
+    bool played;
+    bool finished;  // false — партию оборвал --max-ticks: в журнал и таблицу лидеров она не идёт.
+    int score1;
+    int score2;
+    long long ticks;
+};
+
+static void appendf(std::string& out, const char* format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    out += text;
+}
+
+static std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return std::string();
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+static bool writeAll(int fd, const std::string& data) {
+    const char* bytes = data.data();
+    size_t size = data.size();
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) return false;
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool parseTournamentFormat(const std::string& name, TournamentFormat& format) {
+    if (name == "rr" || name == "round-robin") format = FORMAT_ROUND_ROBIN;
+    else if (name == "se" || name == "single-elimination") format = FORMAT_SINGLE_ELIMINATION;
+    else return false;
+    return true;
+}
+
+bool loadTournamentPlayers(const std::string& path, std::vector<TournamentPlayer>& players, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "Unable to open " + path;
+        return false;
+    }
+    players.clear();
+    std::string line;
+    int number = 0;
+    while (std::getline(file, line)) {
+        number++;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        size_t space = line.find_first_of(" \t");
+        std::string type = line.substr(0, space);
+        TournamentPlayer player;
+        player.name = space == std::string::npos ? std::string() : trim(line.substr(space));
+        player.human = type == "human";
+        player.ai = AI_NORMAL;
+        if ((!player.human && !parseAiType(type, player.ai)) || player.name.empty()) {
+            error = path + ":" + std::to_string(number) + ": expected \"<human|bot|chase|easy|normal|hard|perfect> <name>\"";
+            return false;
+        }
+        for (const TournamentPlayer& other : players) {
+            if (other.name == player.name) {
+                error = path + ":" + std::to_string(number) + ": duplicate player " + player.name;
+                return false;
+            }
+        }
+        players.push_back(player);
+    }
+    if (players.size() < 2) {
+        error = path + ": a tournament needs at least two players";
+        return false;
+    }
+    return true;
+}
+
+bool tournamentHasHumans(const std::vector<TournamentPlayer>& players) {
+    for (const TournamentPlayer& player : players) {
+        if (player.human) return true;
+    }
+    return false;
+}
+
+// Заголовок контрольной точки: по нему --resume проверяет, что турнир тот же.
+static std::string checkpointHeader(const TournamentOptions& options, const std::vector<TournamentPlayer>& players) {
+    std::string header = "PONGTOUR 1\n";
+    header += options.format == FORMAT_ROUND_ROBIN ? "format rr\n" : "format se\n";
+    header += "seed " + std::to_string(options.seed) + "\n";
+    header += "max-ticks " + std::to_string(options.maxTicks) + "\n";
+    for (const TournamentPlayer& player : players) {
+        header += "player " + std::string(player.human ? "human" : aiTypeName(player.ai)) + " " + player.name + "\n";
+    }
+    header += "end\n";
+    return header;
+}
+
+// Записи журнала для пачки; оборванные лимитом тиков партии не результат и пропускаются.
+static std::vector<ScoreEntry> scoreEntries(const std::vector<TournamentPlayer>& players,
+                                            const std::vector<TournamentMatch>& matches) {
+    std::vector<ScoreEntry> entries;
+    int64_t now = static_cast<int64_t>(time(nullptr));
+    for (const TournamentMatch& match : matches) {
+        if (!match.finished) continue;
+        const TournamentPlayer& player1 = players[match.player1];
+        const TournamentPlayer& player2 = players[match.player2];
+        ScoreEntry entry;
+        entry.player1 = player1.name;
+        entry.score1 = match.score1;
+        entry.player2 = player2.name;
+        entry.score2 = match.score2;
+        entry.mode = player1.human && player2.human ? MODE_VERSUS : MODE_COMPUTER;
+        entry.timestamp = now;
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+// Сбор результатов и запись пачками: сначала пачка дописывается в контрольную точку (с числом записей
+// журнала до неё), потом одним appendBatch в журнал. Если процесс упал между двумя записями,
+// при продолжении пачка найдётся в контрольной точке и будет дописана в журнал.
+class ResultSink {
+private:
+    std::mutex mutex;
+    ScoreLog& log;
+    int checkpointFd;
+    size_t batchSize;
+    const std::vector<TournamentPlayer>& players;
+    std::vector<TournamentMatch> pending;
+
+    void flushLocked() {
+        if (pending.empty()) return;
+        std::string text = "batch " + std::to_string(log.getCount()) + " " + std::to_string(pending.size()) + "\n";
+        for (const TournamentMatch& match : pending) {
+            appendf(text, "match %d %d %d %d %d %lld %d\n", match.id, match.player1, match.player2, match.score1,
+                    match.score2, match.ticks, match.finished ? 1 : 0);
+        }
+        if (!writeAll(checkpointFd, text) || fdatasync(checkpointFd) != 0 ||
+            !log.appendBatch(scoreEntries(players, pending))) {
+            failed = true;
+        }
+        batches++;
+        pending.clear();
+    }
+
+public:
+    long long batches = 0;
+    bool failed = false;
+
+    ResultSink(ScoreLog& log, int checkpointFd, int batchSize, const std::vector<TournamentPlayer>& players)
+        : log(log), checkpointFd(checkpointFd), batchSize(static_cast<size_t>(std::max(batchSize, 1))), players(players) {}
+
+    void add(const TournamentMatch& match) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(match);
+        if (pending.size() >= batchSize) flushLocked();
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+        flushLocked();
+    }
+};
+
+// Результат, восстановленный из контрольной точки.
+struct SavedResult {
+    bool played = false;
+    bool finished = true;
+    int score1 = 0;
+    int score2 = 0;
+    long long ticks = 0;
+};
+
+// Чтение контрольной точки. Оборванная последняя пачка отрезается; пачка, которая успела попасть
+// в контрольную точку, но не в журнал, дописывается в журнал.
+static bool restoreCheckpoint(const std::string& path, const std::string& header, ScoreLog& log,
+                              const std::vector<TournamentPlayer>& players, int matchCount,
+                              std::vector<SavedResult>& saved, int& restored, std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        error = "No checkpoint " + path;
+        return false;
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (content.compare(0, header.size(), header) != 0) {
+        error = path + " belongs to a different tournament (players, format or seed changed)";
+        return false;
+    }
+
+    size_t pos = header.size();
+    size_t validEnd = pos;
+    long long lastBefore = -1;
+    std::vector<TournamentMatch> lastBatch;
+    restored = 0;
+    while (pos < content.size()) {
+        size_t end = content.find('\n', pos);
+        if (end == std::string::npos) break;
+        std::istringstream line(content.substr(pos, end - pos));
+        pos = end + 1;
+        std::string word;
+        long long before = 0;
+        int count = 0;
+        if (!(line >> word >> before >> count) || word != "batch" || count <= 0) break;
+
+        std::vector<TournamentMatch> batch;
+        while (static_cast<int>(batch.size()) < count && pos < content.size()) {
+            end = content.find('\n', pos);
+            if (end == std::string::npos) break;
+            std::istringstream matchLine(content.substr(pos, end - pos));
+            pos = end + 1;
+            TournamentMatch match = TournamentMatch();
+            int playerCount = static_cast<int>(players.size());
+            if (!(matchLine >> word >> match.id >> match.player1 >> match.player2 >> match.score1 >> match.score2 >>
+                  match.ticks) || word != "match" || match.id < 0 || match.id >= matchCount || match.player1 < 0 ||
+                match.player1 >= playerCount || match.player2 < 0 || match.player2 >= playerCount) {
+                break;
+            }
+            // Флаг завершения появился позже: в старых контрольных точках его нет, там все партии считались доигранными.
+            int finished = 1;
+            if (!(matchLine >> finished)) finished = 1;
+            match.finished = finished != 0;
+            batch.push_back(match);
+        }
+        if (static_cast<int>(batch.size()) < count) break;
+
+        for (const TournamentMatch& match : batch) {
+            SavedResult& result = saved[match.id];
+            if (!result.played) restored++;
+            result.played = true;
+            result.finished = match.finished;
+            result.score1 = match.score1;
+            result.score2 = match.score2;
+            result.ticks = match.ticks;
+        }
+        validEnd = pos;
+        lastBefore = before;
+        lastBatch = batch;
+    }
+
+    int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(validEnd)) != 0) {
+        if (fd >= 0) ::close(fd);
+        error = "Unable to repair " + path;
+        return false;
+    }
+    ::close(fd);
+
+    // Падение между записью контрольной точки и журнала: журнал остался на числе записей до пачки.
+    if (lastBefore >= 0 && static_cast<long long>(log.getCount()) == lastBefore &&
+        !log.appendBatch(scoreEntries(players, lastBatch))) {
+        error = "Unable to write the score log";
+        return false;
+    }
+    return true;
+}
+
+// Одна волна партий: ИИ против ИИ на пуле в фоновом потоке, партии с людьми по очереди здесь.
+// false — человек прервал турнир.
+struct RoundRunner {
+    const Config& config;
+    const TournamentOptions& options;
+    const std::vector<TournamentPlayer>& players;
+    const HumanMatchFn& humanMatch;
+    ResultSink& sink;
+    int aiPlayed = 0;
+    int humanPlayed = 0;
+    double aiSeconds = 0;
+
+    bool play(std::vector<TournamentMatch*>& matches) {
+        std::vector<TournamentMatch*> ai, human;
+        for (TournamentMatch* match : matches) {
+            if (match->played || match->player2 < 0) continue;
+            bool withHuman = players[match->player1].human || players[match->player2].human;
+            (withHuman ? human : ai).push_back(match);
+        }
+
+        int threads = options.threads > 0 ? options.threads : defaultThreadCount();
+        if (!human.empty()) threads = std::max(1, threads - 1);  // Одно ядро — терминалу.
+        std::thread pool;
+        if (!ai.empty()) {
+            pool = std::thread([&, threads]() {
+                auto start = std::chrono::steady_clock::now();
+                runWorkStealing(threads, static_cast<int>(ai.size()), [&](int task, int) {
+                    TournamentMatch& match = *ai[task];
+                    MatchSpec spec;
+                    spec.config = &config;
+                    spec.seed = options.seed + static_cast<uint64_t>(match.id);
+                    spec.player1 = players[match.player1].ai;
+                    spec.player2 = players[match.player2].ai;
+                    spec.maxTicks = options.maxTicks;
+                    MatchResult result = playMatch(spec);
+                    match.score1 = result.player1Score;
+                    match.score2 = result.player2Score;
+                    match.ticks = result.ticks;
+                    match.finished = result.finished;
+                    match.played = true;
+                    sink.add(match);
+                });
+                aiSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            });
+        }
+
+        bool stopped = false;
+        for (TournamentMatch* match : human) {
+            int score1 = 0, score2 = 0;
+            if (!humanMatch(players[match->player1], players[match->player2], score1, score2)) {
+                stopped = true;
+                break;
+            }
+            match->score1 = score1;
+            match->score2 = score2;
+            match->ticks = 0;
+            match->finished = true;
+            match->played = true;
+            sink.add(*match);
+            humanPlayed++;
+        }
+
+        if (pool.joinable()) pool.join();
+        aiPlayed += static_cast<int>(ai.size());
+        sink.flush();
+        return !stopped;
+    }
+};
+
+// Победитель партии на выбывание; ничья (упёрлись в лимит тиков) — проходит посеянный выше.
+static int winner(const TournamentMatch& match) {
+    if (match.player2 < 0) return match.player1;
+    return match.score2 > match.score1 ? match.player2 : match.player1;
+}
+
+// Пары кругового турнира методом вращения: в каждом туре каждый играет не больше одной партии.
+static std::vector<TournamentMatch> roundRobinMatches(int count) {
+    std::vector<TournamentMatch> matches;
+    int size = count + (count % 2);  // При нечётном числе один в туре отдыхает.
+    std::vector<int> order(size);
+    for (int i = 0; i < size; i++) order[i] = i;
+    for (int round = 0; round < size - 1; round++) {
+        for (int i = 0; i < size / 2; i++) {
+            int a = order[i], b = order[size - 1 - i];
+            if (a >= count || b >= count) continue;
+            TournamentMatch match = TournamentMatch();
+            match.id = static_cast<int>(matches.size());
+            match.round = round;
+            match.player1 = std::min(a, b);
+            match.player2 = std::max(a, b);
+            matches.push_back(match);
+        }
+        std::rotate(order.begin() + 1, order.end() - 1, order.end());
+    }
+    return matches;
+}
+
+static void reportStandings(std::string& report, const std::vector<TournamentPlayer>& players,
+                            const std::vector<TournamentMatch>& matches) {
+    struct Row {
+        int player, played, wins, draws, losses, unfinished, pointsFor, pointsAgainst;
+    };
+    std::vector<Row> rows(players.size());
+    for (size_t i = 0; i < players.size(); i++) rows[i] = Row{static_cast<int>(i), 0, 0, 0, 0, 0, 0, 0};
+    for (const TournamentMatch& match : matches) {
+        if (!match.played) continue;
+        Row& a = rows[match.player1];
+        Row& b = rows[match.player2];
+        a.played++;
+        b.played++;
+        // Оборванная лимитом тиков партия — не ничья: ни очков, ни исхода.
+        if (!match.finished) {
+            a.unfinished++;
+            b.unfinished++;
+            continue;
+        }
+        a.pointsFor += match.score1;
+        a.pointsAgainst += match.score2;
+        b.pointsFor += match.score2;
+        b.pointsAgainst += match.score1;
+        if (match.score1 > match.score2) a.wins++, b.losses++;
+        else if (match.score2 > match.score1) b.wins++, a.losses++;
+        else a.draws++, b.draws++;
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+        if (a.wins != b.wins) return a.wins > b.wins;
+        int diffA = a.pointsFor - a.pointsAgainst, diffB = b.pointsFor - b.pointsAgainst;
+        if (diffA != diffB) return diffA > diffB;
+        return a.player < b.player;
+    });
+    appendf(report, "%4s  %-20s %-8s %6s %4s %4s %4s %4s %6s %6s\n", "#", "player", "type", "played", "W", "D", "L",
+            "cut", "for", "agst");
+    for (size_t i = 0; i < rows.size(); i++) {
+        const Row& row = rows[i];
+        const TournamentPlayer& player = players[row.player];
+        appendf(report, "%4zu  %-20.20s %-8s %6d %4d %4d %4d %4d %6d %6d\n", i + 1, player.name.c_str(),
+                player.human ? "human" : aiTypeName(player.ai), row.played, row.wins, row.draws, row.losses,
+                row.unfinished, row.pointsFor, row.pointsAgainst);
+    }
+}
+
+int runTournament(const Config& config, const TournamentOptions& options, const HumanMatchFn& humanMatch,
+                  std::string& report) {
+    std::vector<TournamentPlayer> players;
+    std::string error;
+    if (!loadTournamentPlayers(options.playersPath, players, error)) {
+        report = "Error: " + error + "\n";
+        return 1;
+    }
+    if (tournamentHasHumans(players) && !humanMatch) {
+        report = "Error: the tournament has human players and needs a terminal\n";
+        return 1;
+    }
+    int count = static_cast<int>(players.size());
+
+    // Все партии турнира с номерами; в турнире на выбывание игроки следующих кругов известны позже.
+    std::vector<TournamentMatch> matches;
+    int bracket = 2;
+    if (options.format == FORMAT_ROUND_ROBIN) {
+        matches = roundRobinMatches(count);
+    } else {
+        while (bracket < count) bracket *= 2;
+        int round = 0;
+        for (int size = bracket / 2; size >= 1; size /= 2, round++) {
+            for (int k = 0; k < size; k++) {
+                TournamentMatch match = TournamentMatch();
+                match.id = static_cast<int>(matches.size());
+                match.round = round;
+                match.player1 = round == 0 ? k : -1;
+                match.player2 = round == 0 ? (bracket - 1 - k < count ? bracket - 1 - k : -1) : -1;
+                matches.push_back(match);
+            }
+        }
+    }
+
+    ScoreLog log(options.scoreBase);
+    if (!log.open()) {
+        report = "Error: Unable to open score log " + options.scoreBase + ".bin" +
+                 (log.getError().empty() ? "" : ": " + log.getError()) + "\n";
+        return 1;
+    }
+
+    std::string checkpointPath = options.playersPath + ".checkpoint";
+    std::string header = checkpointHeader(options, players);
+    std::vector<SavedResult> saved(matches.size());
+    int restored = 0;
+    if (options.resume) {
+        if (!restoreCheckpoint(checkpointPath, header, log, players, static_cast<int>(matches.size()), saved, restored,
+                               error)) {
+            report = "Error: " + error + "\n";
+            return 1;
+        }
+    }
+    int checkpointFd = ::open(checkpointPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | (options.resume ? 0 : O_TRUNC), 0644);
+    if (checkpointFd < 0 || (!options.resume && (!writeAll(checkpointFd, header) || fdatasync(checkpointFd) != 0))) {
+        report = "Error: Unable to write " + checkpointPath + "\n";
+        if (checkpointFd >= 0) ::close(checkpointFd);
+        return 1;
+    }
+
+    ResultSink sink(log, checkpointFd, options.batchSize, players);
+    RoundRunner runner{config, options, players, humanMatch, sink};
+    auto start = std::chrono::steady_clock::now();
+    bool complete = true;
+
+    if (options.format == FORMAT_ROUND_ROBIN) {
+        std::vector<TournamentMatch*> pending;
+        for (TournamentMatch& match : matches) {
+            const SavedResult& result = saved[match.id];
+            match.played = result.played;
+            match.finished = result.finished;
+            match.score1 = result.score1;
+            match.score2 = result.score2;
+            match.ticks = result.ticks;
+            pending.push_back(&match);
+        }
+        complete = runner.play(pending);
+    } else {
+        // Круг за кругом: пары следующего круга — победители соседних партий предыдущего.
+        size_t first = 0;
+        for (int size = bracket / 2; size >= 1 && complete; size /= 2) {
+            std::vector<TournamentMatch*> round;
+            for (int k = 0; k < size; k++) {
+                TournamentMatch& match = matches[first + k];
+                if (first > 0) {
+                    size_t previous = first - 2 * static_cast<size_t>(size);
+                    match.player1 = winner(matches[previous + 2 * k]);
+                    match.player2 = winner(matches[previous + 2 * k + 1]);
+                }
+                const SavedResult& result = saved[match.id];
+                match.played = result.played;
+                match.finished = result.finished;
+                match.score1 = result.score1;
+                match.score2 = result.score2;
+                match.ticks = result.ticks;
+                round.push_back(&match);
+            }
+            complete = runner.play(round);
+            first += static_cast<size_t>(size);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::close(checkpointFd);
+
+    // Снимок таблицы лидеров догоняет журнал один раз за турнир, а не после каждой партии.
+    Leaderboard board;
+    ScoreLogReader reader;
+    openLeaderboard(board, reader, options.scoreBase);
+
+    appendf(report, "Tournament: %s, %d players, %zu matches\n",
+            options.format == FORMAT_ROUND_ROBIN ? "round robin" : "single elimination", count, matches.size());
+    if (options.format == FORMAT_ROUND_ROBIN) {
+        reportStandings(report, players, matches);
+    } else {
+        for (const TournamentMatch& match : matches) {
+            if (match.player1 < 0) continue;
+            if (match.player2 < 0) {
+                appendf(report, "round %d: %s advances (bye)\n", match.round + 1, players[match.player1].name.c_str());
+            } else if (match.played) {
+                appendf(report, "round %d: %s %d : %d %s%s\n", match.round + 1, players[match.player1].name.c_str(),
+                        match.score1, match.score2, players[match.player2].name.c_str(),
+                        match.finished ? "" : " (cut off by --max-ticks, not recorded)");
+            }
+        }
+        if (complete) appendf(report, "Champion: %s\n", players[winner(matches.back())].name.c_str());
+    }
+
+    int played = runner.aiPlayed + runner.humanPlayed;
+    int cut = 0;
+    for (const TournamentMatch& match : matches) cut += match.played && match.player2 >= 0 && !match.finished ? 1 : 0;
+    if (cut > 0) appendf(report, "%d matches cut off by --max-ticks are not in the score log\n", cut);
+    appendf(report, "Played %d matches (%d AI, %d human), %d restored from checkpoint, %lld batched writes\n", played,
+            runner.aiPlayed, runner.humanPlayed, restored, sink.batches);
+    appendf(report, "Time: %.3f s, %.0f matches/min", seconds, seconds > 0 ? played * 60.0 / seconds : 0.0);
+    if (runner.aiSeconds > 0) appendf(report, ", AI matches %.0f/min", runner.aiPlayed * 60.0 / runner.aiSeconds);
+    report += "\n";
+    if (!complete) report += "Tournament paused; continue with --resume\n";
+    if (sink.failed) {
+        report += "Error: Unable to write results\n";
+        return 1;
+    }
+    return 0;
+}
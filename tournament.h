@@ -0,0 +1,54 @@
+#ifndef PONG_TOURNAMENT_H
+#define PONG_TOURNAMENT_H
+
+// Турниры: круговой (каждый с каждым) и на выбывание.
+//
+// Партии ИИ против ИИ играются без терминала параллельно на пуле потоков, партии с людьми —
+// по одной в терминале, пока пул доигрывает остальные. Результаты пачками уходят в журнал
+// счёта; перед каждой пачкой она же дописывается в файл контрольной точки, по которому
+// прерванный турнир продолжается с того же места.
+
+#include "headless.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+enum TournamentFormat {
+    FORMAT_ROUND_ROBIN = 0,
+    FORMAT_SINGLE_ELIMINATION = 1
+};
+
+struct TournamentPlayer {
+    std::string name;
+    bool human;
+    AiType ai;  // Для ИИ-игроков.
+};
+
+struct TournamentOptions {
+    std::string playersPath;  // Список игроков: "<тип> <имя>" в строке, тип — human или имя ИИ.
+    TournamentFormat format = FORMAT_ROUND_ROBIN;
+    bool resume = false;      // Продолжить по <playersPath>.checkpoint.
+    int threads = 0;          // 0 — по числу ядер.
+    uint64_t seed = 1;        // Сид партии — seed + её номер, поэтому повтор турнира даёт те же партии.
+    long long maxTicks = 1000000;
+    int batchSize = 64;       // Результатов в одной пачке записи.
+    std::string scoreBase = "scores";
+};
+
+// Партия с человеком в терминале. Счёт возвращается в порядке player1, player2;
+// false — игрок прервал партию, турнир останавливается до --resume.
+typedef std::function<bool(const TournamentPlayer& player1, const TournamentPlayer& player2,
+                           int& score1, int& score2)> HumanMatchFn;
+
+bool parseTournamentFormat(const std::string& name, TournamentFormat& format);
+// Чтение списка игроков; пустые строки и строки с '#' пропускаются.
+bool loadTournamentPlayers(const std::string& path, std::vector<TournamentPlayer>& players, std::string& error);
+bool tournamentHasHumans(const std::vector<TournamentPlayer>& players);
+
+// Проведение турнира. Отчёт (таблица или сетка, скорость в партиях в минуту) пишется в report,
+// чтобы его можно было вывести после закрытия терминала. Возвращает код завершения процесса.
+int runTournament(const Config& config, const TournamentOptions& options, const HumanMatchFn& humanMatch,
+                  std::string& report);
+
+#endif